@@ -10,6 +10,7 @@
 #ifndef ABIDOCUMENT_H
 #define ABIDOCUMENT_H
 
+#include <memory>
 #include <librevenge/librevenge.h>
 
 #ifdef DLL_EXPORT
@@ -29,6 +30,75 @@
 namespace libabw
 {
 
+struct AbiDocumentHandleImpl;
+
+/**
+How the last call of AbiDocumentHandle::parse shared the property lists of
+its output. The spans, resp. the paragraphs, with the same formatting get
+the same property list, which is built once.
+
+When the document is parsed in two passes, the events of the first pass
+are recorded and replayed in the second one, unless the log would exceed
+its size limit: then the recording stops, the log is truncated and the
+document is parsed again.
+*/
+
+struct AbiDocumentStatistics
+{
+  AbiDocumentStatistics()
+    : m_spanPropListsBuilt(0)
+    , m_spanPropListsReused(0)
+    , m_paragraphPropListsBuilt(0)
+    , m_paragraphPropListsReused(0)
+    , m_savedBytes(0)
+    , m_loggedEvents(0)
+    , m_loggedBytes(0)
+    , m_eventLogTruncated(false)
+  {
+  }
+
+  unsigned long m_spanPropListsBuilt;
+  unsigned long m_spanPropListsReused;
+  unsigned long m_paragraphPropListsBuilt;
+  unsigned long m_paragraphPropListsReused;
+  //! an estimate of the memory the copies of the reused lists would have taken
+  unsigned long m_savedBytes;
+  //! the events recorded in the first pass, 0 if the document was parsed in one pass
+  unsigned long m_loggedEvents;
+  //! the size of the recorded events
+  unsigned long m_loggedBytes;
+  //! whether the recording stopped at the size limit of the log
+  bool m_eventLogTruncated;
+};
+
+/**
+An opened document, returned by AbiDocument::open or AbiDocument::openFile.
+The input is inflated only once and the result of the format detection is
+kept, so checking the document and then parsing it does not do the work
+twice. The input stream passed to AbiDocument::open must outlive the handle.
+*/
+
+class AbiDocumentHandle
+{
+public:
+  ABWAPI ~AbiDocumentHandle();
+  ABWAPI bool isSupported();
+  ABWAPI bool parse(librevenge::RVNGTextInterface *documentInterface);
+  ABWAPI void setStreaming(bool streaming);
+  ABWAPI void setSpillThreshold(unsigned long threshold);
+  ABWAPI void setMergeEvents(bool merge);
+  ABWAPI AbiDocumentStatistics getStatistics() const;
+
+private:
+  explicit AbiDocumentHandle(AbiDocumentHandleImpl *impl);
+  AbiDocumentHandle(const AbiDocumentHandle &);
+  AbiDocumentHandle &operator=(const AbiDocumentHandle &);
+
+  std::unique_ptr<AbiDocumentHandleImpl> m_impl;
+
+  friend class AbiDocument;
+};
+
 /**
 This class provides all the functions an application would need to parse
 AbiWord documents.
@@ -39,6 +109,9 @@ class AbiDocument
 public:
   static ABWAPI bool isFileFormatSupported(librevenge::RVNGInputStream *input);
   static ABWAPI bool parse(librevenge::RVNGInputStream *input, librevenge::RVNGTextInterface *documentInterface);
+  static ABWAPI std::unique_ptr<AbiDocumentHandle> open(librevenge::RVNGInputStream *input);
+  static ABWAPI std::unique_ptr<AbiDocumentHandle> openFile(const char *path);
+  static ABWAPI bool parseFile(const char *path, librevenge::RVNGTextInterface *documentInterface);
 };
 
 } // namespace libabw
@@ -0,0 +1,47 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libabw project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <cstdlib>
+#include <new>
+
+#include "ABWBenchUtils.h"
+
+namespace
+{
+
+unsigned long allocationCount = 0;
+
+} // anonymous namespace
+
+unsigned long libabw::getAllocationCount()
+{
+  return allocationCount;
+}
+
+// the array forms of operator new and delete call these
+
+void *operator new(const std::size_t size)
+{
+  ++allocationCount;
+  if (void *const p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *const p) noexcept
+{
+  std::free(p);
+}
+
+void operator delete(void *const p, std::size_t) noexcept
+{
+  std::free(p);
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,42 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libabw project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef __ABWBENCHUTILS_H__
+#define __ABWBENCHUTILS_H__
+
+#include <chrono>
+
+namespace libabw
+{
+
+// number of calls of the global operator new since the start of the program
+unsigned long getAllocationCount();
+
+// the time spent in the best of repeats runs of f, in seconds, and the allocations done by a run
+template<typename F>
+double measure(const F &f, const int repeats, unsigned long &allocations)
+{
+  double best = 0;
+  for (int i = 0; i < repeats; ++i)
+  {
+    const unsigned long startCount = getAllocationCount();
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    allocations = getAllocationCount() - startCount;
+    if (i == 0 || elapsed.count() < best)
+      best = elapsed.count();
+  }
+  return best;
+}
+
+} // namespace libabw
+
+#endif /* __ABWBENCHUTILS_H__ */
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,113 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libabw project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/* Compares the decoding of embedded data by libabw::appendBase64Data with
+   librevenge::RVNGBinaryData::appendBase64Data, which was used before.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <librevenge/librevenge.h>
+
+#include "ABWBase64.h"
+
+namespace
+{
+
+// base64 text of size bytes of pseudo-random data, in lines of lineLength characters if it is not 0
+std::string makeBase64(const unsigned long size, const unsigned long lineLength)
+{
+  librevenge::RVNGBinaryData data;
+  unsigned state = 12345;
+  for (unsigned long i = 0; i < size; ++i)
+  {
+    state = state * 1103515245 + 12345;
+    data.append((unsigned char)(state >> 16));
+  }
+  const std::string base64(data.getBase64Data().cstr());
+  if (!lineLength)
+    return base64;
+  std::string lines;
+  for (unsigned long i = 0; i < base64.size(); i += lineLength)
+  {
+    lines.append(base64, i, lineLength);
+    lines.push_back('\n');
+  }
+  return lines;
+}
+
+template<typename Decode>
+double measure(const Decode &decode, const int repeats, librevenge::RVNGBinaryData &result)
+{
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < repeats; ++i)
+  {
+    result.clear();
+    decode(result);
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / repeats;
+}
+
+bool run(const char *name, const std::string &base64, const int repeats)
+{
+  librevenge::RVNGBinaryData expected;
+  const double librevengeTime = measure([&base64](librevenge::RVNGBinaryData &data)
+  {
+    data.appendBase64Data(base64.c_str());
+  }, repeats, expected);
+  librevenge::RVNGBinaryData decoded;
+  const double libabwTime = measure([&base64](librevenge::RVNGBinaryData &data)
+  {
+    libabw::appendBase64Data(data, base64.data(), base64.size());
+  }, repeats, decoded);
+
+  const bool same = decoded.size() == expected.size()
+                    && (!decoded.size() || !std::memcmp(decoded.getDataBuffer(), expected.getDataBuffer(), decoded.size()));
+  const double megabytes = double(base64.size()) / (1024 * 1024);
+  std::printf("%-14s %8.1f MB/s %8.1f MB/s %6.1fx%s\n", name, megabytes / librevengeTime, megabytes / libabwTime,
+              librevengeTime / libabwTime, same ? "" : "  MISMATCH");
+  return same;
+}
+
+} // anonymous namespace
+
+int main(int argc, char *argv[])
+{
+  const unsigned long size = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 16 * 1024 * 1024;
+  const int repeats = 5;
+
+  std::printf("%-14s %13s %13s\n", "", "librevenge", "libabw");
+  bool ok = run("one line", makeBase64(size, 0), repeats);
+  ok = run("76 per line", makeBase64(size, 76), repeats) && ok;
+  // the odd lengths and line breaks exercise the tails of the vector loops
+  for (unsigned long length = 1; length < 200; ++length)
+  {
+    for (unsigned long lineLength = 0; lineLength < 70; lineLength += 23)
+    {
+      const std::string base64 = makeBase64(length, lineLength);
+      librevenge::RVNGBinaryData expected;
+      expected.appendBase64Data(base64.c_str());
+      librevenge::RVNGBinaryData decoded;
+      libabw::appendBase64Data(decoded, base64.data(), base64.size());
+      if (decoded.size() != expected.size() || std::memcmp(decoded.getDataBuffer(), expected.getDataBuffer(), decoded.size()))
+      {
+        std::printf("MISMATCH for %lu bytes in lines of %lu\n", length, lineLength);
+        ok = false;
+      }
+    }
+  }
+  return ok ? 0 : 1;
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
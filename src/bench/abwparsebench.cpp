@@ -0,0 +1,122 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libabw project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/* Measures what libabw spends on the text boxes and on the footnotes of
+   a document: each text box is parsed with a collector of its own, and
+   each note with a parsing state of its own. Each generated document is
+   compared with one holding the same paragraphs outside of the text boxes,
+   resp. of the notes, so that the difference is the cost of the text boxes
+   or of the notes alone.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include <librevenge/librevenge.h>
+#include <librevenge-generators/librevenge-generators.h>
+#include <librevenge-stream/librevenge-stream.h>
+
+#include <libabw/libabw.h>
+
+#include "ABWBenchUtils.h"
+
+namespace
+{
+
+const char *const HEADER =
+  "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+  "<abiword xmlns=\"http://www.abisource.com/awml.dtd\" version=\"1.0\">\n"
+  "<section props=\"page-margin-left:1in; page-margin-right:1in\">\n";
+const char *const FOOTER = "</section>\n</abiword>\n";
+
+// count paragraphs, each followed by a text box if inFrames or by a paragraph
+std::string makeFramesDocument(const unsigned count, const bool inFrames)
+{
+  std::string document(HEADER);
+  for (unsigned i = 0; i < count; ++i)
+  {
+    const std::string number = std::to_string(i);
+    const std::string box = "<p props=\"text-align:center\">Box <c props=\"font-weight:bold\">" + number + "</c></p>";
+    document += "<p>Paragraph " + number;
+    if (inFrames)
+      document += "<frame props=\"frame-type:textbox; position-to:block-above-text; frame-width:2in; frame-height:1in\">"
+                  + box + "</frame></p>\n";
+    else
+      document += "</p>" + box + "\n";
+  }
+  document += FOOTER;
+  return document;
+}
+
+// count paragraphs, each ending with a footnote if inNotes or followed by a paragraph
+std::string makeNotesDocument(const unsigned count, const bool inNotes)
+{
+  std::string document(HEADER);
+  for (unsigned i = 0; i < count; ++i)
+  {
+    const std::string number = std::to_string(i);
+    const std::string note = "<p style=\"Footnote Text\">See <c props=\"font-style:italic\">ref. " + number + "</c></p>";
+    document += "<p>Paragraph " + number;
+    if (inNotes)
+      document += "<field type=\"footnote_ref\" footnote-id=\"" + number + "\"/>"
+                  "<foot footnote-id=\"" + number + "\">" + note + "</foot></p>\n";
+    else
+      document += "</p>" + note + "\n";
+  }
+  document += FOOTER;
+  return document;
+}
+
+bool parse(const std::string &document)
+{
+  librevenge::RVNGStringStream input(reinterpret_cast<const unsigned char *>(document.data()),
+                                     unsigned(document.size()));
+  librevenge::RVNGString text;
+  librevenge::RVNGTextTextGenerator generator(text, false);
+  return libabw::AbiDocument::parse(&input, &generator);
+}
+
+bool run(const char *name, const std::string &plain, const std::string &withItems, const unsigned count,
+         const int repeats)
+{
+  bool ok = true;
+  unsigned long plainAllocations = 0;
+  const double plainTime = libabw::measure([&plain, &ok]()
+  {
+    ok = parse(plain) && ok;
+  }, repeats, plainAllocations);
+  unsigned long allocations = 0;
+  const double time = libabw::measure([&withItems, &ok]()
+  {
+    ok = parse(withItems) && ok;
+  }, repeats, allocations);
+
+  std::printf("%-10s %8.1f ms %8.1f ms %8.2f us %9.1f\n", name, 1000 * plainTime, 1000 * time,
+              1000000 * (time - plainTime) / count, (double(allocations) - double(plainAllocations)) / count);
+  if (!ok)
+    std::printf("%s: PARSING FAILED\n", name);
+  return ok;
+}
+
+} // anonymous namespace
+
+int main(int argc, char *argv[])
+{
+  const unsigned count = argc > 1 ? unsigned(std::strtoul(argv[1], nullptr, 10)) : 10000;
+  const int repeats = 5;
+
+  std::printf("%u items; cost per item compared with the same paragraphs in the body\n", count);
+  std::printf("%-10s %11s %11s %11s %9s\n", "", "body", "items", "time", "allocs");
+  bool ok = run("frames", makeFramesDocument(count, false), makeFramesDocument(count, true), count, repeats);
+  ok = run("footnotes", makeNotesDocument(count, false), makeNotesDocument(count, true), count, repeats) && ok;
+  return ok ? 0 : 1;
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,146 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libabw project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+/* Compares libabw::parsePropString with the boost::algorithm::split
+   based parser it replaced, on the props attributes of a generated
+   document with many formatted paragraphs, spans and table cells.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/algorithm/string.hpp>
+
+#include "ABWBenchUtils.h"
+#include "ABWCollector.h"
+
+namespace
+{
+
+void oldParsePropString(const std::string &str, std::map<std::string, std::string> &props)
+{
+  if (str.empty())
+    return;
+
+  std::string propString(boost::trim_copy(str));
+  std::vector<std::string> strVec;
+  boost::algorithm::split(strVec, propString, boost::is_any_of(";"), boost::token_compress_on);
+  for (auto &i : strVec)
+  {
+    boost::algorithm::trim(i);
+    std::vector<std::string> tmpVec;
+    boost::algorithm::split(tmpVec, i, boost::is_any_of(":"), boost::token_compress_on);
+    if (tmpVec.size() == 2)
+      props[tmpVec[0]] = tmpVec[1];
+  }
+}
+
+const char *const PROPS[] =
+{
+  "font-family:Times New Roman", "font-size:12pt", "font-weight:bold", "font-style:italic",
+  "color:1f3a5c", "bgcolor:transparent", "text-decoration:underline", "text-position:superscript",
+  "lang:en-US", "text-align:justify", "margin-left:0.5in", "margin-right:0.0000in",
+  "margin-top:6pt", "margin-bottom:0.1in", "line-height:1.15", "text-indent:-0.25in",
+  "widows:2", "orphans:2", "keep-with-next:yes", "dom-dir:ltr", "tabstops:1.0in/L0,2.5in/C1",
+  "left-color:000000", "left-style:1", "left-thickness:0.72pt", "top-attach:3", "bot-attach:4",
+  "left-attach:0", "right-attach:1", "table-column-props:1.2in/2.4in/1.8in/", "table-row-heights:0.3in/",
+  "frame-type:textbox", "wrap-mode:wrapped-both", "position-to:page-above-text", "frame-page-xpos:1.5in",
+  "list-style:Numbered List", "start-value:1", "field-font:NULL", "list-delim:%L.", "list-decimal:."
+};
+
+// the props attributes of a document of count paragraphs, spans and cells
+std::vector<std::string> makeCorpus(const unsigned count)
+{
+  const unsigned propCount = sizeof(PROPS) / sizeof(PROPS[0]);
+  std::vector<std::string> corpus;
+  corpus.reserve(count);
+  unsigned state = 12345;
+  for (unsigned i = 0; i < count; ++i)
+  {
+    std::string props;
+    state = state * 1103515245 + 12345;
+    const unsigned pairs = 1 + (state >> 16) % 12;
+    for (unsigned j = 0; j < pairs; ++j)
+    {
+      state = state * 1103515245 + 12345;
+      if (j)
+        props += (state & 0x100) ? "; " : ";";
+      props += PROPS[(state >> 16) % propCount];
+    }
+    corpus.push_back(props);
+  }
+  return corpus;
+}
+
+} // anonymous namespace
+
+int main(int argc, char *argv[])
+{
+  const unsigned count = argc > 1 ? unsigned(std::strtoul(argv[1], nullptr, 10)) : 200000;
+  const int repeats = 5;
+
+  const std::vector<std::string> corpus = makeCorpus(count);
+  unsigned long bytes = 0;
+  for (const auto &props : corpus)
+    bytes += props.size();
+
+  std::map<std::string, std::string> oldProps;
+  unsigned long oldAllocations = 0;
+  const double oldTime = libabw::measure([&corpus, &oldProps]()
+  {
+    for (const auto &props : corpus)
+    {
+      oldProps.clear();
+      oldParsePropString(props, oldProps);
+    }
+  }, repeats, oldAllocations);
+
+  libabw::ABWPropertyMap newProps;
+  unsigned long newAllocations = 0;
+  const double newTime = libabw::measure([&corpus, &newProps]()
+  {
+    for (const auto &props : corpus)
+    {
+      newProps.clear();
+      libabw::parsePropString(props.c_str(), newProps);
+    }
+  }, repeats, newAllocations);
+
+  // both parsers must find the same properties
+  bool ok = true;
+  for (const auto &props : corpus)
+  {
+    oldProps.clear();
+    oldParsePropString(props, oldProps);
+    newProps.clear();
+    libabw::parsePropString(props.c_str(), newProps);
+    for (const auto &prop : oldProps)
+    {
+      const std::string *const value = newProps.find(prop.first);
+      if (!value || *value != prop.second)
+      {
+        std::printf("MISMATCH for \"%s\"\n", props.c_str());
+        ok = false;
+        break;
+      }
+    }
+  }
+
+  const double megabytes = double(bytes) / (1024 * 1024);
+  std::printf("%u props attributes, %.1f MB\n", count, megabytes);
+  std::printf("%-8s %8.1f MB/s %6.2f allocations per attribute\n", "split", megabytes / oldTime, double(oldAllocations) / count);
+  std::printf("%-8s %8.1f MB/s %6.2f allocations per attribute\n", "scan", megabytes / newTime, double(newAllocations) / count);
+  std::printf("speedup  %.1fx\n", oldTime / newTime);
+  return ok ? 0 : 1;
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -8,7 +8,6 @@
  */
 
 #include <stdio.h>
-#include <librevenge-stream/librevenge-stream.h>
 #include <librevenge-generators/librevenge-generators.h>
 #include <libabw/libabw.h>
 #include <string.h>
@@ -66,9 +65,9 @@ int main(int argc, char *argv[])
   if (!file)
     return printUsage();
 
-  librevenge::RVNGFileStream input(file);
+  std::unique_ptr<libabw::AbiDocumentHandle> abiDocument(libabw::AbiDocument::openFile(file));
 
-  if (!libabw::AbiDocument::isFileFormatSupported(&input))
+  if (!abiDocument || !abiDocument->isSupported())
   {
     fprintf(stderr, "ERROR: Unsupported file format!\n");
     return 1;
@@ -76,7 +75,7 @@ int main(int argc, char *argv[])
 
   librevenge::RVNGString document;
   librevenge::RVNGHTMLTextGenerator documentGenerator(document);
-  if (!libabw::AbiDocument::parse(&input, &documentGenerator))
+  if (!abiDocument->parse(&documentGenerator))
     return 1;
 
   printf("%s", document.cstr());
@@ -8,7 +8,7 @@
  */
 
 #include <stdio.h>
-#include <librevenge-stream/librevenge-stream.h>
+#include <stdlib.h>
 #include <librevenge-generators/librevenge-generators.h>
 #include <libabw/libabw.h>
 #include <string.h>
@@ -35,6 +35,10 @@ int printUsage()
   printf("\n");
   printf("Options:\n");
   printf("\t--callgraph           display the call graph nesting level\n");
+  printf("\t--merge               merge adjacent spans and texts\n");
+  printf("\t--spill=SIZE          move the buffered events and texts to a file above SIZE bytes\n");
+  printf("\t--stats               print the sharing of the property lists and the event log size to stderr\n");
+  printf("\t--stream              write the document while it is read\n");
   printf("\t--help                show this help message\n");
   printf("\t--version             show version information\n");
   printf("\n");
@@ -53,6 +57,10 @@ int printVersion()
 int main(int argc, char *argv[])
 {
   bool printIndentLevel = false;
+  bool streaming = false;
+  unsigned long spillThreshold = 0;
+  bool mergeEvents = false;
+  bool printStatistics = false;
   char *file = nullptr;
 
   if (argc < 2)
@@ -62,6 +70,14 @@ int main(int argc, char *argv[])
   {
     if (!strcmp(argv[i], "--callgraph"))
       printIndentLevel = true;
+    else if (!strcmp(argv[i], "--stream"))
+      streaming = true;
+    else if (!strcmp(argv[i], "--merge"))
+      mergeEvents = true;
+    else if (!strncmp(argv[i], "--spill=", 8))
+      spillThreshold = strtoul(argv[i] + 8, nullptr, 10);
+    else if (!strcmp(argv[i], "--stats"))
+      printStatistics = true;
     else if (!strcmp(argv[i], "--version"))
       return printVersion();
     else if (!file && strncmp(argv[i], "--", 2))
@@ -73,17 +89,30 @@ int main(int argc, char *argv[])
   if (!file)
     return printUsage();
 
-  librevenge::RVNGFileStream input(file);
+  std::unique_ptr<libabw::AbiDocumentHandle> abiDocument(libabw::AbiDocument::openFile(file));
 
-  if (!libabw::AbiDocument::isFileFormatSupported(&input))
+  if (!abiDocument || !abiDocument->isSupported())
   {
     fprintf(stderr, "ERROR: Unsupported file format!\n");
     return 1;
   }
 
+  abiDocument->setStreaming(streaming);
+  abiDocument->setSpillThreshold(spillThreshold);
+  abiDocument->setMergeEvents(mergeEvents);
   librevenge::RVNGRawTextGenerator documentGenerator(printIndentLevel);
-  if (libabw::AbiDocument::parse(&input, &documentGenerator))
-    return 0;
-  return 1;
+  const bool parsed = abiDocument->parse(&documentGenerator);
+  if (printStatistics)
+  {
+    const libabw::AbiDocumentStatistics statistics = abiDocument->getStatistics();
+    fprintf(stderr, "span property lists: %lu built, %lu reused\n",
+            statistics.m_spanPropListsBuilt, statistics.m_spanPropListsReused);
+    fprintf(stderr, "paragraph property lists: %lu built, %lu reused\n",
+            statistics.m_paragraphPropListsBuilt, statistics.m_paragraphPropListsReused);
+    fprintf(stderr, "about %lu bytes saved\n", statistics.m_savedBytes);
+    fprintf(stderr, "event log: %lu events, %lu bytes%s\n", statistics.m_loggedEvents,
+            statistics.m_loggedBytes, statistics.m_eventLogTruncated ? ", truncated" : "");
+  }
+  return parsed ? 0 : 1;
 }
 /* vim:set shiftwidth=2 softtabstop=2 expandtab: */
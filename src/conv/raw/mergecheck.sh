@@ -0,0 +1,62 @@
+#!/bin/sh
+# Checks that --merge only merges adjacent spans with the same properties
+# and consecutive texts, also with --stream and --spill: once these are
+# merged in the output without --merge too, both outputs are the same.
+
+doc="${srcdir:-.}/merge-spans.abw"
+
+normalize()
+{
+  awk '
+    function flushText()
+    {
+      if (hasText)
+        print "insertText(" text ")"
+      text = ""
+      hasText = 0
+    }
+    {
+      sub(/^[ \t]+/, "")
+      if (closePending)
+      {
+        closePending = 0
+        if ($0 == span)
+          next
+        flushText()
+        print "closeSpan()"
+      }
+      if ($0 ~ /^insertText\(/)
+      {
+        t = $0
+        sub(/^insertText\((text: )?/, "", t)
+        sub(/\)$/, "", t)
+        text = text t
+        hasText = 1
+        next
+      }
+      if ($0 == "closeSpan()")
+      {
+        closePending = 1
+        next
+      }
+      flushText()
+      if ($0 ~ /^openSpan\(/)
+        span = $0
+      print
+    }
+    END {
+      flushText()
+      if (closePending)
+        print "closeSpan()"
+    }' "$1"
+}
+
+for mode in "" "--stream" "--spill=1"; do
+  ./abw2raw $mode "$doc" > merge-spans.out || exit 1
+  ./abw2raw $mode --merge "$doc" > merge-spans-merged.out || exit 1
+  # the check means nothing if no event was merged
+  test "$(wc -l < merge-spans-merged.out)" -lt "$(wc -l < merge-spans.out)" || exit 1
+  normalize merge-spans.out > merge-spans.norm
+  normalize merge-spans-merged.out > merge-spans-merged.norm
+  cmp merge-spans.norm merge-spans-merged.norm || exit 1
+done
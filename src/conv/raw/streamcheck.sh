@@ -0,0 +1,11 @@
+#!/bin/sh
+# Checks that a document is written the same way with and without
+# --stream, and is started once, although its text box opens a page span.
+
+doc="${srcdir:-.}/frame-list.abw"
+
+./abw2raw "$doc" > frame-list.out || exit 1
+./abw2raw --stream "$doc" > frame-list-stream.out || exit 1
+cmp frame-list.out frame-list-stream.out || exit 1
+test "$(grep -c '^startDocument' frame-list-stream.out)" = 1 || exit 1
+head -n 1 frame-list-stream.out | grep -q '^startDocument'
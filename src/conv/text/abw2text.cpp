@@ -10,7 +10,6 @@
 
 #include <stdio.h>
 #include <string.h>
-#include <librevenge-stream/librevenge-stream.h>
 #include <librevenge-generators/librevenge-generators.h>
 #include <libabw/libabw.h>
 
@@ -71,9 +70,9 @@ int main(int argc, char *argv[])
   if (!szInputFile)
     return printUsage();
 
-  librevenge::RVNGFileStream input(szInputFile);
+  std::unique_ptr<libabw::AbiDocumentHandle> abiDocument(libabw::AbiDocument::openFile(szInputFile));
 
-  if (!libabw::AbiDocument::isFileFormatSupported(&input))
+  if (!abiDocument || !abiDocument->isSupported())
   {
     fprintf(stderr, "ERROR: Unsupported file format!\n");
     return 1;
@@ -81,7 +80,7 @@ int main(int argc, char *argv[])
 
   librevenge::RVNGString document;
   librevenge::RVNGTextTextGenerator documentGenerator(document, isInfo);
-  if (!libabw::AbiDocument::parse(&input, &documentGenerator))
+  if (!abiDocument->parse(&documentGenerator))
     return 1;
 
   printf("%s", document.cstr());
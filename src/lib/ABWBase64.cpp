@@ -0,0 +1,313 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libabw project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <memory>
+#include <string>
+#include "ABWBase64.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define ABW_BASE64_X86 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+// NEON is part of AArch64, and can be used unconditionally if the compiler targets it
+#define ABW_BASE64_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace libabw
+{
+
+namespace
+{
+
+enum
+{
+  INVALID = -1,
+  SPACE = -2,
+  PADDING = -3
+};
+
+struct DecodeTable
+{
+  DecodeTable() : m_values()
+  {
+    for (signed char &value : m_values)
+      value = INVALID;
+    for (int i = 0; i < 26; ++i)
+    {
+      m_values['A' + i] = (signed char) i;
+      m_values['a' + i] = (signed char)(26 + i);
+    }
+    for (int i = 0; i < 10; ++i)
+      m_values['0' + i] = (signed char)(52 + i);
+    m_values[(unsigned char) '+'] = 62;
+    m_values[(unsigned char) '/'] = 63;
+    m_values[(unsigned char) ' '] = SPACE;
+    m_values[(unsigned char) '\t'] = SPACE;
+    m_values[(unsigned char) '\r'] = SPACE;
+    m_values[(unsigned char) '\n'] = SPACE;
+    m_values[(unsigned char) '='] = PADDING;
+  }
+
+  signed char m_values[256];
+};
+
+static const DecodeTable DECODE_TABLE;
+
+#ifdef ABW_BASE64_X86
+
+static bool hasSSSE3()
+{
+  static const bool result = __builtin_cpu_supports("ssse3");
+  return result;
+}
+
+static bool hasAVX2()
+{
+  static const bool result = __builtin_cpu_supports("avx2");
+  return result;
+}
+
+/* Like decodeBlocksSSSE3, for blocks of 32 characters. It writes 32 bytes
+   per block, so the output needs 8 bytes to spare.
+ */
+__attribute__((target("avx2")))
+static void decodeBlocksAVX2(const unsigned char *&src, const unsigned char *const srcEnd, unsigned char *&dst)
+{
+  const __m256i lutLo = _mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                         0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+                                         0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                         0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+  const __m256i lutHi = _mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                         0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                         0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                         0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m256i lutRoll = _mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+                                           0, 0, 0, 0, 0, 0, 0, 0,
+                                           0, 16, 19, 4, -65, -65, -71, -71,
+                                           0, 0, 0, 0, 0, 0, 0, 0);
+  const __m256i mask2F = _mm256_set1_epi8(0x2f);
+
+  while (srcEnd - src >= 32)
+  {
+    __m256i str = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+    const __m256i hiNibbles = _mm256_and_si256(_mm256_srli_epi32(str, 4), mask2F);
+    const __m256i loNibbles = _mm256_and_si256(str, mask2F);
+    const __m256i hi = _mm256_shuffle_epi8(lutHi, hiNibbles);
+    const __m256i lo = _mm256_shuffle_epi8(lutLo, loNibbles);
+    if (!_mm256_testz_si256(lo, hi))
+      return;
+    const __m256i eq2F = _mm256_cmpeq_epi8(str, mask2F);
+    const __m256i roll = _mm256_shuffle_epi8(lutRoll, _mm256_add_epi8(eq2F, hiNibbles));
+    str = _mm256_add_epi8(str, roll);
+
+    // pack the 4 x 6 bits of each dword into 3 bytes, then the 12 bytes of each lane together
+    const __m256i mergedPairs = _mm256_maddubs_epi16(str, _mm256_set1_epi32(0x01400140));
+    const __m256i merged = _mm256_madd_epi16(mergedPairs, _mm256_set1_epi32(0x00011000));
+    str = _mm256_shuffle_epi8(merged, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                                       2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    str = _mm256_permutevar8x32_epi32(str, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), str);
+
+    src += 32;
+    dst += 24;
+  }
+}
+
+/* Decodes whole blocks of 16 characters into 12 bytes, as long as they only
+   contain base64 characters; the rest is left to the scalar decoder.
+   It writes 16 bytes per block, so the output needs 4 bytes to spare.
+   The lookup tables validate and translate the characters by their high
+   and low nibbles, as described by Wojciech Muła.
+ */
+__attribute__((target("ssse3")))
+static void decodeBlocksSSSE3(const unsigned char *&src, const unsigned char *const srcEnd, unsigned char *&dst)
+{
+  const __m128i lutLo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                      0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+  const __m128i lutHi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m128i lutRoll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+                                        0, 0, 0, 0, 0, 0, 0, 0);
+  const __m128i mask2F = _mm_set1_epi8(0x2f);
+  const __m128i zero = _mm_setzero_si128();
+
+  while (srcEnd - src >= 16)
+  {
+    __m128i str = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+    const __m128i hiNibbles = _mm_and_si128(_mm_srli_epi32(str, 4), mask2F);
+    const __m128i loNibbles = _mm_and_si128(str, mask2F);
+    const __m128i hi = _mm_shuffle_epi8(lutHi, hiNibbles);
+    const __m128i lo = _mm_shuffle_epi8(lutLo, loNibbles);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi), zero)) != 0xffff)
+      return;
+    const __m128i eq2F = _mm_cmpeq_epi8(str, mask2F);
+    const __m128i roll = _mm_shuffle_epi8(lutRoll, _mm_add_epi8(eq2F, hiNibbles));
+    str = _mm_add_epi8(str, roll);
+
+    // pack the 4 x 6 bits of each dword into 3 bytes
+    const __m128i mergedPairs = _mm_maddubs_epi16(str, _mm_set1_epi32(0x01400140));
+    const __m128i merged = _mm_madd_epi16(mergedPairs, _mm_set1_epi32(0x00011000));
+    str = _mm_shuffle_epi8(merged, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), str);
+
+    src += 16;
+    dst += 12;
+  }
+}
+
+#elif defined(ABW_BASE64_NEON)
+
+// Translates the base64 characters to their values, clearing valid where they are not base64
+static inline uint8x16_t decodeCharsNEON(const uint8x16_t chars, uint8x16_t &valid)
+{
+  const uint8x16_t upper = vandq_u8(vcgeq_u8(chars, vdupq_n_u8('A')), vcleq_u8(chars, vdupq_n_u8('Z')));
+  const uint8x16_t lower = vandq_u8(vcgeq_u8(chars, vdupq_n_u8('a')), vcleq_u8(chars, vdupq_n_u8('z')));
+  const uint8x16_t digit = vandq_u8(vcgeq_u8(chars, vdupq_n_u8('0')), vcleq_u8(chars, vdupq_n_u8('9')));
+  const uint8x16_t plus = vceqq_u8(chars, vdupq_n_u8('+'));
+  const uint8x16_t slash = vceqq_u8(chars, vdupq_n_u8('/'));
+  valid = vandq_u8(valid, vorrq_u8(vorrq_u8(vorrq_u8(upper, lower), vorrq_u8(digit, plus)), slash));
+  // the offsets are added modulo 256
+  const uint8x16_t offset = vorrq_u8(vorrq_u8(vandq_u8(upper, vdupq_n_u8(256 - 65)), vandq_u8(lower, vdupq_n_u8(256 - 71))),
+                                     vorrq_u8(vorrq_u8(vandq_u8(digit, vdupq_n_u8(4)), vandq_u8(plus, vdupq_n_u8(19))),
+                                              vandq_u8(slash, vdupq_n_u8(16))));
+  return vaddq_u8(chars, offset);
+}
+
+/* Decodes whole blocks of 64 characters into 48 bytes, as long as they only
+   contain base64 characters; the rest is left to the scalar decoder. The
+   characters are loaded deinterleaved, so that each vector holds one of the
+   4 characters of 16 quanta.
+ */
+static void decodeBlocksNEON(const unsigned char *&src, const unsigned char *const srcEnd, unsigned char *&dst)
+{
+  while (srcEnd - src >= 64)
+  {
+    const uint8x16x4_t chars = vld4q_u8(src);
+    uint8x16_t valid = vdupq_n_u8(0xff);
+    const uint8x16_t a = decodeCharsNEON(chars.val[0], valid);
+    const uint8x16_t b = decodeCharsNEON(chars.val[1], valid);
+    const uint8x16_t c = decodeCharsNEON(chars.val[2], valid);
+    const uint8x16_t d = decodeCharsNEON(chars.val[3], valid);
+    const uint8x8_t validHalves = vand_u8(vget_low_u8(valid), vget_high_u8(valid));
+    if (vget_lane_u64(vreinterpret_u64_u8(validHalves), 0) != ~uint64_t(0))
+      return;
+
+    uint8x16x3_t bytes;
+    bytes.val[0] = vorrq_u8(vshlq_n_u8(a, 2), vshrq_n_u8(b, 4));
+    bytes.val[1] = vorrq_u8(vshlq_n_u8(b, 4), vshrq_n_u8(c, 2));
+    bytes.val[2] = vorrq_u8(vshlq_n_u8(c, 6), d);
+    vst3q_u8(dst, bytes);
+
+    src += 64;
+    dst += 48;
+  }
+}
+
+#endif
+
+/* Decodes the text into dst, which must have room for length * 3 / 4 + 16
+   bytes. Returns false if the text is not valid base64.
+ */
+static bool decodeBase64(const unsigned char *src, unsigned long length, unsigned char *const dst, unsigned long &dstLength)
+{
+  const signed char *const table = DECODE_TABLE.m_values;
+  const unsigned char *const srcEnd = src + length;
+  unsigned char *out = dst;
+  unsigned value = 0;
+  int count = 0;
+
+  while (src != srcEnd)
+  {
+    if (count == 0)
+    {
+#if defined(ABW_BASE64_X86)
+      if (hasAVX2())
+        decodeBlocksAVX2(src, srcEnd, out);
+      if (hasSSSE3())
+        decodeBlocksSSSE3(src, srcEnd, out);
+#elif defined(ABW_BASE64_NEON)
+      decodeBlocksNEON(src, srcEnd, out);
+#endif
+      while (srcEnd - src >= 4)
+      {
+        const int a = table[src[0]];
+        const int b = table[src[1]];
+        const int c = table[src[2]];
+        const int d = table[src[3]];
+        if ((a | b | c | d) < 0)
+          break;
+        const unsigned quantum = unsigned(a) << 18 | unsigned(b) << 12 | unsigned(c) << 6 | unsigned(d);
+        out[0] = (unsigned char)(quantum >> 16);
+        out[1] = (unsigned char)(quantum >> 8);
+        out[2] = (unsigned char) quantum;
+        out += 3;
+        src += 4;
+      }
+      if (src == srcEnd)
+        break;
+    }
+
+    const int v = table[*src++];
+    if (v >= 0)
+    {
+      value = value << 6 | unsigned(v);
+      if (++count == 4)
+      {
+        out[0] = (unsigned char)(value >> 16);
+        out[1] = (unsigned char)(value >> 8);
+        out[2] = (unsigned char) value;
+        out += 3;
+        value = 0;
+        count = 0;
+      }
+    }
+    else if (v == PADDING)
+    {
+      // only padding and white space may follow
+      for (; src != srcEnd; ++src)
+      {
+        if (table[*src] != PADDING && table[*src] != SPACE)
+          return false;
+      }
+    }
+    else if (v != SPACE)
+      return false;
+  }
+
+  // a partial quantum
+  if (count == 2)
+    *out++ = (unsigned char)(value >> 4);
+  else if (count == 3)
+  {
+    *out++ = (unsigned char)(value >> 10);
+    *out++ = (unsigned char)(value >> 2);
+  }
+
+  dstLength = (unsigned long)(out - dst);
+  return true;
+}
+
+} // anonymous namespace
+
+void appendBase64Data(librevenge::RVNGBinaryData &data, const char *base64, unsigned long length)
+{
+  if (!base64 || !length)
+    return;
+
+  std::unique_ptr<unsigned char[]> buffer(new unsigned char[length / 4 * 3 + 16]);
+  unsigned long decodedLength = 0;
+  if (decodeBase64(reinterpret_cast<const unsigned char *>(base64), length, buffer.get(), decodedLength))
+    data.append(buffer.get(), decodedLength);
+  else // leave the handling of invalid data to librevenge
+    data.appendBase64Data(std::string(base64, length).c_str());
+}
+
+} // namespace libabw
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,26 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libabw project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef __ABWBASE64_H__
+#define __ABWBASE64_H__
+
+#include <librevenge/librevenge.h>
+
+namespace libabw
+{
+
+// Decodes length bytes of base64 text, skipping white space, and appends
+// the result to data. Unlike RVNGBinaryData::appendBase64Data, the text
+// does not need to be null-terminated.
+void appendBase64Data(librevenge::RVNGBinaryData &data, const char *base64, unsigned long length);
+
+} // namespace libabw
+
+#endif // __ABWBASE64_H__
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -7,11 +7,13 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/.
  */
 
-#include <boost/algorithm/string.hpp>
+#include <algorithm>
+
 #include <boost/optional.hpp>
 #include <boost/spirit/include/qi.hpp>
 
 #include "ABWCollector.h"
+#include "ABWBase64.h"
 
 bool libabw::findInt(const std::string &str, int &res)
 {
@@ -24,21 +26,66 @@ bool libabw::findInt(const std::string &str, int &res)
   return phrase_parse(it, str.cend(), int_, space, res) && it == str.cend();
 }
 
-void libabw::parsePropString(const std::string &str, ABWPropertyMap &props)
+namespace
 {
-  if (str.empty())
+
+bool isPropSpace(const char c)
+{
+  return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+struct UnitSymbols : boost::spirit::qi::symbols<char, std::pair<libabw::ABWUnit, double>>
+{
+  UnitSymbols()
+  {
+    add
+    ("cm", {libabw::ABW_IN, 2.54})
+    ("inch", {libabw::ABW_IN, 1.0})
+    ("in", {libabw::ABW_IN, 1.0})
+    ("mm", {libabw::ABW_IN, 25.4})
+    ("pi", {libabw::ABW_IN, 6.0})
+    ("pt", {libabw::ABW_IN, 72.0})
+    ("px", {libabw::ABW_IN, 72.0})
+    ("%", {libabw::ABW_PERCENT, 100.0})
+    ;
+  }
+};
+
+} // anonymous namespace
+
+void libabw::parsePropString(const char *const str, ABWPropertyMap &props)
+{
+  if (!str)
     return;
 
-  std::string propString(boost::trim_copy(str));
-  std::vector<std::string> strVec;
-  boost::algorithm::split(strVec, propString, boost::is_any_of(";"), boost::token_compress_on);
-  for (auto &i : strVec)
+  // The properties are "key:value" pairs separated by ';'. Runs of
+  // separators count as one and each pair is trimmed, but nothing else
+  // is, so the value keeps any spaces after the ':'. Pairs with more than
+  // one run of ':' are ignored.
+  const char *pos = str;
+  while (*pos)
   {
-    boost::algorithm::trim(i);
-    std::vector<std::string> tmpVec;
-    boost::algorithm::split(tmpVec, i, boost::is_any_of(":"), boost::token_compress_on);
-    if (tmpVec.size() == 2)
-      props[tmpVec[0]] = tmpVec[1];
+    const char *start = pos;
+    while (*pos && *pos != ';')
+      ++pos;
+    const char *end = pos;
+    while (*pos == ';')
+      ++pos;
+
+    while (start != end && isPropSpace(*start))
+      ++start;
+    while (end != start && isPropSpace(*(end - 1)))
+      --end;
+
+    const char *const keyEnd = std::find(start, end, ':');
+    if (keyEnd == end)
+      continue;
+    const char *value = keyEnd;
+    while (value != end && *value == ':')
+      ++value;
+    if (std::find(value, end, ':') != end)
+      continue;
+    props.set(start, unsigned(keyEnd - start), value, unsigned(end - value));
   }
 }
 
@@ -49,17 +96,7 @@ bool libabw::findDouble(const std::string &str, double &res, ABWUnit &unit)
   if (str.empty())
     return false;
 
-  symbols<char, std::pair<ABWUnit, double>> units;
-  units.add
-  ("cm", {ABW_IN, 2.54})
-  ("inch", {ABW_IN, 1.0})
-  ("in", {ABW_IN, 1.0})
-  ("mm", {ABW_IN, 25.4})
-  ("pi", {ABW_IN, 6.0})
-  ("pt", {ABW_IN, 72.0})
-  ("px", {ABW_IN, 72.0})
-  ("%", {ABW_PERCENT, 100.0})
-  ;
+  static const UnitSymbols units;
 
   boost::optional<std::pair<ABWUnit, double>> u;
 
@@ -80,6 +117,93 @@ bool libabw::findDouble(const std::string &str, double &res, ABWUnit &unit)
   return true;
 }
 
+libabw::ABWDataMap::Entry::Entry()
+  : m_data()
+  , m_isLazy(false)
+  , m_isDecoded(false)
+  , m_offset(0)
+  , m_length(0)
+  , m_isBase64(false)
+  , m_useCount(0)
+{
+}
+
+libabw::ABWDataMap::ABWDataMap()
+  : m_source(nullptr)
+  , m_sourceSize(0)
+  , m_entries()
+{
+}
+
+void libabw::ABWDataMap::setSource(const unsigned char *source, unsigned long size)
+{
+  m_source = source;
+  m_sourceSize = size;
+}
+
+void libabw::ABWDataMap::insert(const std::string &name, const ABWData &data)
+{
+  Entry &entry = m_entries[name];
+  entry.m_data = data;
+  entry.m_isLazy = false;
+  entry.m_isDecoded = true;
+}
+
+void libabw::ABWDataMap::insertLazy(const std::string &name, const librevenge::RVNGString &mimeType,
+                                    unsigned long offset, unsigned long length, bool base64)
+{
+  Entry &entry = m_entries[name];
+  entry.m_data = ABWData(mimeType, librevenge::RVNGBinaryData());
+  entry.m_isLazy = true;
+  entry.m_isDecoded = false;
+  entry.m_offset = offset;
+  entry.m_length = length;
+  entry.m_isBase64 = base64;
+}
+
+void libabw::ABWDataMap::addUse(const std::string &name)
+{
+  ++m_entries[name].m_useCount;
+}
+
+const libabw::ABWData *libabw::ABWDataMap::acquire(const std::string &name)
+{
+  auto iter = m_entries.find(name);
+  if (iter == m_entries.end())
+    return nullptr;
+  Entry &entry = iter->second;
+  if (!entry.m_isDecoded)
+  {
+    if (!entry.m_isLazy) // only used, never inserted
+      return nullptr;
+    if (!m_source || entry.m_offset + entry.m_length > m_sourceSize)
+      return nullptr;
+    const unsigned char *const payload = m_source + entry.m_offset;
+    if (entry.m_isBase64)
+      appendBase64Data(entry.m_data.m_binaryData, reinterpret_cast<const char *>(payload), entry.m_length);
+    else
+      entry.m_data.m_binaryData.append(payload, entry.m_length);
+    entry.m_isDecoded = true;
+  }
+  return &entry.m_data;
+}
+
+void libabw::ABWDataMap::release(const std::string &name)
+{
+  auto iter = m_entries.find(name);
+  if (iter == m_entries.end())
+    return;
+  Entry &entry = iter->second;
+  if (entry.m_useCount > 0)
+    --entry.m_useCount;
+  // it can be decoded again if it is used more often than counted
+  if (entry.m_isLazy && entry.m_useCount == 0)
+  {
+    entry.m_data.m_binaryData = librevenge::RVNGBinaryData();
+    entry.m_isDecoded = false;
+  }
+}
+
 void libabw::ABWListElement::writeOut(librevenge::RVNGPropertyList &propList) const
 {
   if (m_listLevel > 0)
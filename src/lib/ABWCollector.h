@@ -14,33 +14,21 @@
 #include <map>
 #include <librevenge/librevenge.h>
 
+#include "ABWPropertyMap.h"
+
 namespace libabw
 {
 class ABWOutputElements;
 
-enum ABWUnit
-{
-  ABW_NONE,
-  ABW_CM,
-  ABW_IN,
-  ABW_MM,
-  ABW_PI,
-  ABW_PT,
-  ABW_PX,
-  ABW_PERCENT
-};
-
 enum ABWListType
 {
   ABW_ORDERED,
   ABW_UNORDERED
 };
 
-typedef std::map<std::string, std::string> ABWPropertyMap;
-
 bool findInt(const std::string &str, int &res);
 bool findDouble(const std::string &str, double &res, ABWUnit &unit);
-void parsePropString(const std::string &str, ABWPropertyMap &props);
+void parsePropString(const char *str, ABWPropertyMap &props);
 
 struct ABWData
 {
@@ -57,6 +45,53 @@ struct ABWData
   librevenge::RVNGBinaryData m_binaryData;
 };
 
+/* The embedded data of the document, by name.
+
+   Data whose payload can be found verbatim in the document buffer are only
+   stored as a location in it and decoded when they are first used. Once
+   all the recorded uses are done, the decoded data are dropped again.
+ */
+class ABWDataMap
+{
+public:
+  ABWDataMap();
+
+  /* The document buffer that lazy data are read from. It has to stay
+     valid as long as lazy data may be used. */
+  void setSource(const unsigned char *source, unsigned long size);
+
+  void insert(const std::string &name, const ABWData &data);
+  void insertLazy(const std::string &name, const librevenge::RVNGString &mimeType,
+                  unsigned long offset, unsigned long length, bool base64);
+
+  // counts one more use of the data
+  void addUse(const std::string &name);
+  // gets the data, decoding them if needed; returns 0 if there are no such data
+  const ABWData *acquire(const std::string &name);
+  // ends one use of the data
+  void release(const std::string &name);
+
+private:
+  struct Entry
+  {
+    Entry();
+
+    ABWData m_data;
+    bool m_isLazy;
+    bool m_isDecoded;
+    unsigned long m_offset;
+    unsigned long m_length;
+    bool m_isBase64;
+    unsigned m_useCount;
+  };
+
+  const unsigned char *m_source;
+  unsigned long m_sourceSize;
+  std::map<std::string, Entry> m_entries;
+  ABWDataMap(const ABWDataMap &);
+  ABWDataMap &operator=(const ABWDataMap &);
+};
+
 struct ABWListElement
 {
   ABWListElement()
@@ -143,6 +178,8 @@ public:
                            const char *parentid, const char *startValue, const char *type) = 0;
 
   virtual void collectData(const char *name, const char *mimeType, const librevenge::RVNGBinaryData &data) = 0;
+  // whether collectData does anything; if not, the data are not decoded at all
+  virtual bool isDataCollected() const = 0;
   virtual void collectHeaderFooter(const char *id, const char *type) = 0;
 
   virtual void openTable(const char *props) = 0;
@@ -155,6 +192,19 @@ public:
   virtual void addFrameElements(ABWOutputElements &elements, bool pageFrame) = 0;
 
   virtual void addMetadataEntry(const char *name, const char *value) = 0;
+
+  // prepare the collector to collect another frame, keeping its parsing state storage and an output chunk
+  // per list; false if it can not be reused
+  virtual bool reset()
+  {
+    return false;
+  }
+
+  // false if a part of the output could not be written
+  virtual bool isOutputComplete() const
+  {
+    return true;
+  }
 };
 
 } // namespace libabw
@@ -12,9 +12,11 @@
 #endif
 
 #include <cassert>
+#include <cstring>
 #include <locale>
 #include <memory>
 #include <sstream>
+#include <string>
 
 #include <boost/spirit/include/qi.hpp>
 #include <boost/algorithm/string.hpp>
@@ -26,6 +28,11 @@
 #define ABW_EPSILON 1.0E-06
 #define MAX_LIST_LEVEL 64 // a safeguard against damaged files
 
+#if defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+#define ABW_TEXT_SSE2 1
+#include <emmintrin.h>
+#endif
+
 using boost::optional;
 
 namespace libabw
@@ -54,71 +61,71 @@ static std::string getColor(const std::string &s)
   return out;
 }
 
-static void separateTabsAndInsertText(ABWOutputElements &outputElements, const librevenge::RVNGString &text)
-{
-  if (text.empty())
-    return;
-  librevenge::RVNGString tmpText;
-  librevenge::RVNGString::Iter i(text);
-  for (i.rewind(); i.next();)
+/* Finds the first character from pos on which ends a run of text: a tab,
+   a line break or a space following another space. As the bytes of the
+   multibyte UTF-8 characters are all above 0x7f, it looks at the bytes.
+ */
+static unsigned long findTextBreak(const char *const text, unsigned long pos, const unsigned long length)
+{
+#ifdef ABW_TEXT_SSE2
+  const __m128i tabs = _mm_set1_epi8('\t');
+  const __m128i lineBreaks = _mm_set1_epi8('\n');
+  const __m128i spaces = _mm_set1_epi8(' ');
+  for (; pos + 16 <= length; pos += 16)
+  {
+    const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + pos));
+    const unsigned spaceMask = unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(chars, spaces)));
+    const unsigned afterSpaceMask = (spaceMask << 1) | (pos > 0 && text[pos - 1] == ' ' ? 1 : 0);
+    const unsigned breakMask = unsigned(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chars, tabs), _mm_cmpeq_epi8(chars, lineBreaks))))
+                               | (spaceMask & afterSpaceMask);
+    if (breakMask)
+      return pos + unsigned(__builtin_ctz(breakMask));
+  }
+#endif
+  for (; pos < length; ++pos)
   {
-    if (*(i()) == '\t')
-    {
-      if (!tmpText.empty())
-      {
-        outputElements.addInsertText(tmpText);
-        tmpText.clear();
-      }
-      outputElements.addInsertTab();
-    }
-    else if (*(i()) == '\n'|| *(i()) == (char)0x0a)
-    {
-      if (!tmpText.empty())
-      {
-        outputElements.addInsertText(tmpText);
-        tmpText.clear();
-      }
-      outputElements.addInsertLineBreak();
-    }
-    else
-    {
-      tmpText.append(i());
-    }
+    if (text[pos] == '\t' || text[pos] == '\n' || (text[pos] == ' ' && pos > 0 && text[pos - 1] == ' '))
+      return pos;
   }
-  if (!tmpText.empty())
-    outputElements.addInsertText(tmpText);
+  return length;
 }
 
-static void separateSpacesAndInsertText(ABWOutputElements &outputElements, const librevenge::RVNGString &text)
+/* Inserts the text, with the tabs and the line breaks as such. The spaces
+   following another one are inserted as such too, to be kept.
+
+   The pieces are terminated in place in a copy of the text made in buffer,
+   so each one is only copied into its RVNGString.
+ */
+static void separateAndInsertText(ABWOutputElements &outputElements, const char *const text, std::string &buffer)
 {
-  if (text.empty())
+  const unsigned long length = std::strlen(text);
+  if (!length)
   {
-    outputElements.addInsertText(text);
+    outputElements.addInsertText(librevenge::RVNGString());
     return;
   }
-  librevenge::RVNGString tmpText;
-  int numConsecutiveSpaces = 0;
-  librevenge::RVNGString::Iter i(text);
-  for (i.rewind(); i.next();)
+  unsigned long pos = findTextBreak(text, 0, length);
+  if (pos < length)
+    buffer.assign(text, length);
+  unsigned long start = 0;
+  for (; pos < length; pos = findTextBreak(text, start, length))
   {
-    if (*(i()) == ' ')
-      numConsecutiveSpaces++;
-    else
-      numConsecutiveSpaces = 0;
-
-    if (numConsecutiveSpaces > 1)
+    if (pos > start)
     {
-      if (!tmpText.empty())
-      {
-        separateTabsAndInsertText(outputElements, tmpText);
-        tmpText.clear();
-      }
-      outputElements.addInsertSpace();
+      buffer[pos] = '\0';
+      outputElements.addInsertText(librevenge::RVNGString(&buffer[start]));
     }
+    if (text[pos] == '\t')
+      outputElements.addInsertTab();
+    else if (text[pos] == '\n')
+      outputElements.addInsertLineBreak();
     else
-      tmpText.append(i());
+      outputElements.addInsertSpace();
+    start = pos + 1;
   }
-  separateTabsAndInsertText(outputElements, tmpText);
+  // the rest is terminated already
+  if (start < length)
+    outputElements.addInsertText(librevenge::RVNGString(text + start));
 }
 
 void parseTableColumns(const std::string &str, librevenge::RVNGPropertyListVector &columns)
@@ -269,14 +276,11 @@ static std::string decodeUrl(const std::string &str)
   return str;
 }
 
-std::string findProperty(const ABWPropertyMap &propMap, const char *const name)
+const std::string &findProperty(const ABWPropertyMap &propMap, const int id)
 {
-  if (!name)
-    return std::string();
-  auto iter = propMap.find(name);
-  if (iter != propMap.end())
-    return iter->second;
-  return std::string();
+  static const std::string empty;
+  const std::string *const value = propMap.find(id);
+  return value ? *value : empty;
 }
 
 } // anonymous namespace
@@ -421,42 +425,93 @@ libabw::ABWContentParsingState::~ABWContentParsingState()
 {
 }
 
-libabw::ABWContentCollector::ABWContentCollector(librevenge::RVNGTextInterface *iface, const std::map<int, int> &tableSizes,
-                                                 const std::map<std::string, ABWData> &data,
-                                                 const std::map<int, std::shared_ptr<ABWListElement>> &listElements) :
-  m_ps(new ABWContentParsingState),
-  m_iface(iface),
-  m_parsingStates(),
+void libabw::ABWContentParsingState::clear()
+{
+  m_isDocumentStarted = false;
+  m_isPageSpanOpened = false;
+  m_isSectionOpened = false;
+  m_isHeaderOpened = false;
+  m_isFooterOpened = false;
+
+  m_isPageFrame = false;
+
+  m_isSpanOpened = false;
+  m_isParagraphOpened = false;
+  m_isListElementOpened = false;
+  m_inParagraphOrListElement = false;
+
+  m_currentSectionStyle.clear();
+  m_currentParagraphStyle.clear();
+  m_currentCharacterStyle.clear();
+
+  m_pageWidth = 0.0;
+  m_pageHeight = 0.0;
+  m_pageMarginTop = 0.0;
+  m_pageMarginBottom = 0.0;
+  m_pageMarginLeft = 0.0;
+  m_pageMarginRight = 0.0;
+  m_footerId = -1;
+  m_footerLeftId = -1;
+  m_footerFirstId = -1;
+  m_footerLastId = -1;
+  m_headerId = -1;
+  m_headerLeftId = -1;
+  m_headerFirstId = -1;
+  m_headerLastId = -1;
+  m_currentHeaderFooterId = -1;
+  m_currentHeaderFooterOccurrence.clear();
+  m_parsingContext = ABW_SECTION;
+
+  m_deferredPageBreak = false;
+  m_deferredColumnBreak = false;
+
+  m_isNote = false;
+  m_currentListLevel = 0;
+  m_currentListId = 0;
+  m_isFirstTextInListElement = false;
+
+  while (!m_tableStates.empty())
+    m_tableStates.pop();
+  while (!m_listLevels.empty())
+    m_listLevels.pop();
+}
+
+libabw::ABWStyleRegistry::ABWStyleRegistry() :
   m_dontLoop(),
   m_textStyles(),
-  m_documentStyle(),
-  m_metadata(),
-  m_data(data),
-  m_tableSizes(tableSizes),
-  m_tableCounter(0),
-  m_outputElements(),
-  m_pageOutputElements(),
-  m_listElements(listElements),
-  m_dummyListElements()
+  m_resolvedTextStyles(),
+  m_documentProperties()
 {
 }
 
-libabw::ABWContentCollector::~ABWContentCollector()
+void libabw::ABWStyleRegistry::addTextStyle(const char *const name, const ABWStyle &style)
 {
+  m_textStyles[name] = style;
+  m_resolvedTextStyles.clear();
 }
 
-void libabw::ABWContentCollector::collectTextStyle(const char *name, const char *basedon, const char *followedby, const char *props)
+const libabw::ABWPropertyMap &libabw::ABWStyleRegistry::getTextStyleProperties(const char *const name)
 {
-  ABWStyle style;
-  style.basedon = basedon ? basedon : std::string();
-  style.followedby = followedby ? followedby : std::string();
-  if (props)
-    parsePropString(props, style.properties);
-  if (name)
-    m_textStyles[name] = style;
+  auto iter = m_resolvedTextStyles.find(name);
+  if (iter == m_resolvedTextStyles.end())
+  {
+    iter = m_resolvedTextStyles.insert(std::make_pair(std::string(name), ABWPropertyMap())).first;
+    _recurseTextProperties(name, iter->second);
+  }
+  return iter->second;
+}
+
+void libabw::ABWStyleRegistry::collectDocumentProperties(const char *const props)
+{
+  parsePropString(props, m_documentProperties);
 }
 
-void libabw::ABWContentCollector::_recurseTextProperties(const char *name, ABWPropertyMap &styleProps)
+const libabw::ABWPropertyMap &libabw::ABWStyleRegistry::getDocumentProperties() const
+{
+  return m_documentProperties;
+}
+
+void libabw::ABWStyleRegistry::_recurseTextProperties(const char *name, ABWPropertyMap &styleProps)
 {
   if (name)
   {
@@ -466,8 +521,7 @@ void libabw::ABWContentCollector::_recurseTextProperties(const char *name, ABWPr
       _recurseTextProperties(iter->second.basedon.c_str(), styleProps);
     if (iter != m_textStyles.end())
     {
-      for (const auto &propertie : iter->second.properties)
-        styleProps[propertie.first] = propertie.second;
+      styleProps.merge(iter->second.properties);
     }
 
     // Styles based on "Heading X" style are recognized as headings.
@@ -479,7 +533,7 @@ void libabw::ABWContentCollector::_recurseTextProperties(const char *name, ABWPr
       {
         // Abiword only has 4 levels of headings, but allow some more
         if ((0 < level) && (10 > level))
-          styleProps["libabw:outline-level"] = levelStr;
+          styleProps.set(PROP_LIBABW_OUTLINE_LEVEL, levelStr);
       }
     }
   }
@@ -487,68 +541,122 @@ void libabw::ABWContentCollector::_recurseTextProperties(const char *name, ABWPr
     m_dontLoop.clear();
 }
 
-std::string libabw::ABWContentCollector::_findDocumentProperty(const char *const name)
+libabw::ABWContentCollector::ABWContentCollector(librevenge::RVNGTextInterface *iface, const std::map<int, int> &tableSizes,
+                                                 ABWDataMap &data,
+                                                 const std::map<int, std::shared_ptr<ABWListElement>> &listElements,
+                                                 ABWStyleRegistry &styles, ABWPropertyListPool &spanPropLists,
+                                                 ABWPropertyListPool &paragraphPropLists,
+                                                 ABWOutputElements *documentElements,
+                                                 const bool streaming, const unsigned long spillThreshold,
+                                                 const bool mergeEvents) :
+  m_ps(new ABWContentParsingState),
+  m_iface(iface),
+  m_parsingStates(),
+  m_spareParsingStates(),
+  m_styles(styles),
+  m_spanPropLists(spanPropLists),
+  m_paragraphPropLists(paragraphPropLists),
+  m_propListCacheKey(),
+  m_textBuffer(),
+  m_metadata(),
+  m_data(data),
+  m_tableSizes(tableSizes),
+  m_tableCounter(0),
+  m_outputElements(),
+  m_pageOutputElements(),
+  m_listElements(listElements),
+  m_dummyListElements(),
+  m_documentElements(documentElements),
+  m_isStreaming(streaming),
+  m_isOutputComplete(true)
 {
-  return findProperty(m_documentStyle, name);
+  m_outputElements.setSpillThreshold(spillThreshold);
+  m_outputElements.setMergingEvents(mergeEvents);
+  m_pageOutputElements.setMergingEvents(mergeEvents);
 }
 
-std::string libabw::ABWContentCollector::_findParagraphProperty(const char *name)
+libabw::ABWContentCollector::~ABWContentCollector()
 {
-  return findProperty(m_ps->m_currentParagraphStyle, name);
 }
 
-std::string libabw::ABWContentCollector::_findTableProperty(const char *name)
+void libabw::ABWContentCollector::collectTextStyle(const char *name, const char *basedon, const char *followedby, const char *props)
+{
+  ABWStyle style;
+  style.basedon = basedon ? basedon : std::string();
+  style.followedby = followedby ? followedby : std::string();
+  if (props)
+    parsePropString(props, style.properties);
+  if (name)
+    m_styles.addTextStyle(name, style);
+}
+
+const std::string &libabw::ABWContentCollector::_findDocumentProperty(const int id)
+{
+  return findProperty(m_styles.getDocumentProperties(), id);
+}
+
+const std::string &libabw::ABWContentCollector::_findParagraphProperty(const int id)
+{
+  return findProperty(m_ps->m_currentParagraphStyle, id);
+}
+
+const std::string &libabw::ABWContentCollector::_findTableProperty(const int id)
 {
   assert(!m_ps->m_tableStates.empty());
-  return findProperty(m_ps->m_tableStates.top().m_currentTableProperties, name);
+  return findProperty(m_ps->m_tableStates.top().m_currentTableProperties, id);
 }
 
-std::string libabw::ABWContentCollector::_findCellProperty(const char *name)
+const std::string &libabw::ABWContentCollector::_findCellProperty(const int id)
 {
   assert(!m_ps->m_tableStates.empty());
-  return findProperty(m_ps->m_tableStates.top().m_currentCellProperties, name);
+  return findProperty(m_ps->m_tableStates.top().m_currentCellProperties, id);
 }
 
-std::string libabw::ABWContentCollector::_findSectionProperty(const char *name)
+const std::string &libabw::ABWContentCollector::_findSectionProperty(const int id)
 {
-  return findProperty(m_ps->m_currentSectionStyle, name);
+  return findProperty(m_ps->m_currentSectionStyle, id);
 }
 
-std::string libabw::ABWContentCollector::_findCharacterProperty(const char *name)
+const std::string &libabw::ABWContentCollector::_findCharacterProperty(const int id)
 {
-  std::string prop = findProperty(m_ps->m_currentCharacterStyle, name);
-  if (prop.empty())
-    prop = findProperty(m_ps->m_currentParagraphStyle, name);
-  return prop;
+  return findProperty(_getCharacterPropertyMap(id), id);
+}
+
+const libabw::ABWPropertyMap &libabw::ABWContentCollector::_getCharacterPropertyMap(const int id)
+{
+  if (findProperty(m_ps->m_currentCharacterStyle, id).empty())
+    return m_ps->m_currentParagraphStyle;
+  return m_ps->m_currentCharacterStyle;
 }
 
 std::string libabw::ABWContentCollector::_findMetadataEntry(const char *const name)
 {
-  return findProperty(m_metadata, name);
+  const std::string *const value = m_metadata.find(name);
+  return value ? *value : std::string();
 }
 
 void libabw::ABWContentCollector::collectDocumentProperties(const char *const props)
 {
   if (props)
-    parsePropString(props, m_documentStyle);
+    m_styles.collectDocumentProperties(props);
 }
 
-void libabw::ABWContentCollector::_addBorderProperties(const std::map<std::string, std::string> &map, librevenge::RVNGPropertyList &propList, const std::string &defaultUndefBorderProp)
+void libabw::ABWContentCollector::_addBorderProperties(const ABWPropertyMap &map, librevenge::RVNGPropertyList &propList, const std::string &defaultUndefBorderProp)
 {
   int setBorders=0;
   static char const *odtWh[4]= {"fo:border-left", "fo:border-right", "fo:border-top", "fo:border-bottom"};
   for (int i=0, depl=1; i<4; ++i, depl*=2)
   {
-    static char const *wh[4]= {"left", "right", "top", "bot"};
-    std::string whString(wh[i]);
-    std::string tmp=whString+"-color";
-    if (map.find(tmp)==map.end()) continue;
-    std::string color=getColor(map.find(tmp)->second);
+    static const int colorIds[4]= {PROP_LEFT_COLOR, PROP_RIGHT_COLOR, PROP_TOP_COLOR, PROP_BOT_COLOR};
+    static const int styleIds[4]= {PROP_LEFT_STYLE, PROP_RIGHT_STYLE, PROP_TOP_STYLE, PROP_BOT_STYLE};
+    static const int thicknessIds[4]= {PROP_LEFT_THICKNESS, PROP_RIGHT_THICKNESS, PROP_TOP_THICKNESS, PROP_BOT_THICKNESS};
+    const std::string *prop=map.find(colorIds[i]);
+    if (!prop) continue;
+    std::string color=getColor(*prop);
     if (color.empty())
       continue;
     int style;
-    tmp=whString+"-style";
-    if (map.find(tmp)==map.end() || !findInt(map.find(tmp)->second, style))
+    if (!map.findInt(styleIds[i], style))
       style=1;
     else if (style<=0 || style>=4)
     {
@@ -557,8 +665,7 @@ void libabw::ABWContentCollector::_addBorderProperties(const std::map<std::strin
     }
     ABWUnit unit(ABW_NONE);
     double width(0.0);
-    tmp=whString+"-thickness";
-    if (map.find(tmp)==map.end() || !findDouble(map.find(tmp)->second, width, unit))
+    if (!map.findDouble(thicknessIds[i], width, unit))
       width=0.01;
     else if (width<=0 || unit != ABW_IN)
       continue;
@@ -590,17 +697,12 @@ void libabw::ABWContentCollector::collectParagraphProperties(const char *level,
   if (!listid || !findInt(listid, m_ps->m_currentListId) || m_ps->m_currentListId < 0)
     m_ps->m_currentListId = 0;
 
-  m_ps->m_currentParagraphStyle.clear();
-  if (style)
-    _recurseTextProperties(style, m_ps->m_currentParagraphStyle);
-  else
-    _recurseTextProperties("Normal", m_ps->m_currentParagraphStyle);
+  m_ps->m_currentParagraphStyle = m_styles.getTextStyleProperties(style ? style : "Normal");
 
   ABWPropertyMap tmpProps;
   if (props)
     parsePropString(props, tmpProps);
-  for (ABWPropertyMap::const_iterator iter = tmpProps.begin(); iter != tmpProps.end(); ++iter)
-    m_ps->m_currentParagraphStyle[iter->first] = iter->second;
+  m_ps->m_currentParagraphStyle.merge(tmpProps);
   m_ps->m_inParagraphOrListElement = true;
 }
 
@@ -611,15 +713,15 @@ void libabw::ABWContentCollector::collectCharacterProperties(const char *style,
   if (m_ps->m_isSpanOpened)
     _closeSpan();
 
-  m_ps->m_currentCharacterStyle.clear();
   if (style)
-    _recurseTextProperties(style, m_ps->m_currentCharacterStyle);
+    m_ps->m_currentCharacterStyle = m_styles.getTextStyleProperties(style);
+  else
+    m_ps->m_currentCharacterStyle.clear();
 
   ABWPropertyMap tmpProps;
   if (props)
     parsePropString(props, tmpProps);
-  for (ABWPropertyMap::const_iterator iter = tmpProps.begin(); iter != tmpProps.end(); ++iter)
-    m_ps->m_currentCharacterStyle[iter->first] = iter->second;
+  m_ps->m_currentCharacterStyle.merge(tmpProps);
 }
 
 void libabw::ABWContentCollector::collectSectionProperties(const char *footer, const char *footerLeft, const char *footerFirst, const char *footerLast,
@@ -649,30 +751,23 @@ void libabw::ABWContentCollector::collectSectionProperties(const char *footer, c
 
   ABWUnit unit(ABW_NONE);
   double value(0.0);
-  for (ABWPropertyMap::const_iterator iter = tmpProps.begin(); iter != tmpProps.end(); ++iter)
+  const std::pair<int, double *> pageMargins[] =
   {
-    if (iter->first == "page-margin-right" && !iter->second.empty() && fabs(m_ps->m_pageMarginRight) < ABW_EPSILON)
-    {
-      if (findDouble(iter->second, value, unit) && unit == ABW_IN && value > 0.0 && fabs(value) > ABW_EPSILON)
-        m_ps->m_pageMarginRight = value;
-    }
-    else if (iter->first == "page-margin-left" && !iter->second.empty() && fabs(m_ps->m_pageMarginLeft) < ABW_EPSILON)
-    {
-      if (findDouble(iter->second, value, unit) && unit == ABW_IN && value > 0.0 && fabs(value) > ABW_EPSILON)
-        m_ps->m_pageMarginLeft = value;
-    }
-    else if (iter->first == "page-margin-top" && !iter->second.empty() && fabs(m_ps->m_pageMarginTop) < ABW_EPSILON)
-    {
-      if (findDouble(iter->second, value, unit) && unit == ABW_IN && value > 0.0 && fabs(value) > ABW_EPSILON)
-        m_ps->m_pageMarginTop = value;
-    }
-    else if (iter->first == "page-margin-bottom" && !iter->second.empty() && fabs(m_ps->m_pageMarginBottom) < ABW_EPSILON)
+    {PROP_PAGE_MARGIN_RIGHT, &m_ps->m_pageMarginRight},
+    {PROP_PAGE_MARGIN_LEFT, &m_ps->m_pageMarginLeft},
+    {PROP_PAGE_MARGIN_TOP, &m_ps->m_pageMarginTop},
+    {PROP_PAGE_MARGIN_BOTTOM, &m_ps->m_pageMarginBottom}
+  };
+  for (const auto &pageMargin : pageMargins)
+  {
+    const std::string *const prop = tmpProps.find(pageMargin.first);
+    if (prop && !prop->empty() && fabs(*pageMargin.second) < ABW_EPSILON)
     {
-      if (findDouble(iter->second, value, unit) && unit == ABW_IN && value > 0.0 && fabs(value) > ABW_EPSILON)
-        m_ps->m_pageMarginBottom = value;
+      if (tmpProps.findDouble(pageMargin.first, value, unit) && unit == ABW_IN && value > 0.0 && fabs(value) > ABW_EPSILON)
+        *pageMargin.second = value;
     }
-    m_ps->m_currentSectionStyle[iter->first] = iter->second;
   }
+  m_ps->m_currentSectionStyle.merge(tmpProps);
 
   int intValue(0);
   if (footer && findInt(footer, intValue) && intValue >= 0)
@@ -788,9 +883,10 @@ void libabw::ABWContentCollector::startDocument()
   if (!m_ps->m_isNote && m_ps->m_tableStates.empty())
   {
 
-    if (m_iface && !m_ps->m_isDocumentStarted)
+    // a frame opening a page span must not start the document again
+    if (m_documentElements && !m_ps->m_isDocumentStarted)
     {
-      m_iface->startDocument(librevenge::RVNGPropertyList());
+      m_documentElements->addStartDocument(librevenge::RVNGPropertyList());
       _setMetadata();
     }
 
@@ -817,10 +913,19 @@ void libabw::ABWContentCollector::endDocument()
 
     _closePageSpan();
 
+    ABW_DEBUG_MSG(("libabw::ABWContentCollector::endDocument: span property lists: %lu reused, %lu built\n",
+                   m_spanPropLists.getStats().m_uses - m_spanPropLists.getStats().m_lists, m_spanPropLists.getStats().m_lists));
+    ABW_DEBUG_MSG(("libabw::ABWContentCollector::endDocument: paragraph property lists: %lu reused, %lu built\n",
+                   m_paragraphPropLists.getStats().m_uses - m_paragraphPropLists.getStats().m_lists, m_paragraphPropLists.getStats().m_lists));
+
     if (m_iface)
     {
-      m_pageOutputElements.write(m_iface);
-      m_outputElements.write(m_iface);
+      if (m_documentElements && !m_documentElements->write(m_iface))
+        m_isOutputComplete = false;
+      if (!m_pageOutputElements.write(m_iface))
+        m_isOutputComplete = false;
+      if (!m_outputElements.write(m_iface))
+        m_isOutputComplete = false;
       m_iface->endDocument();
     }
   }
@@ -856,8 +961,7 @@ void libabw::ABWContentCollector::_setMetadata()
 #endif
   std::string generator = "libabw/" + version;
   propList.insert("meta:generator", generator.c_str());
-  if (m_iface)
-    m_iface->setDocumentMetaData(propList);
+  m_documentElements->addSetDocumentMetaData(propList);
 }
 
 void libabw::ABWContentCollector::endSection()
@@ -867,6 +971,7 @@ void libabw::ABWContentCollector::endSection()
   _closeHeader();
   _closeFooter();
   _closeSection();
+  _flushOutput();
 }
 
 void libabw::ABWContentCollector::closeParagraphOrListElement()
@@ -877,6 +982,16 @@ void libabw::ABWContentCollector::closeParagraphOrListElement()
   _closeBlock();
   m_ps->m_currentParagraphStyle.clear();
   m_ps->m_inParagraphOrListElement = false;
+  _flushOutput();
+}
+
+void libabw::ABWContentCollector::_flushOutput()
+{
+  if (!m_isStreaming || !m_iface || !m_documentElements)
+    return;
+  // only the collector of the document adds startDocument, before its first page span, so it is written first
+  if (!m_documentElements->flush(m_iface) || !m_outputElements.flush(m_iface))
+    m_isOutputComplete = false;
 }
 
 void libabw::ABWContentCollector::openLink(const char *href)
@@ -936,9 +1051,9 @@ void libabw::ABWContentCollector::insertText(const char *text)
   if (!text)
     return;
   if (m_ps->m_isFirstTextInListElement && text[0] == '\t')
-    separateSpacesAndInsertText(m_outputElements, text+1);
+    separateAndInsertText(m_outputElements, text+1, m_textBuffer);
   else
-    separateSpacesAndInsertText(m_outputElements, text);
+    separateAndInsertText(m_outputElements, text, m_textBuffer);
   m_ps->m_isFirstTextInListElement = false;
 }
 
@@ -993,25 +1108,25 @@ void libabw::ABWContentCollector::_openSection()
 
     ABWUnit unit(ABW_NONE);
     double value(0.0);
-    if (findDouble(_findSectionProperty("page-margin-right"), value, unit) && unit == ABW_IN)
+    if (m_ps->m_currentSectionStyle.findDouble(PROP_PAGE_MARGIN_RIGHT, value, unit) && unit == ABW_IN)
       propList.insert("fo:margin-right", value - m_ps->m_pageMarginRight);
 
-    if (findDouble(_findSectionProperty("page-margin-left"), value, unit) && unit == ABW_IN)
+    if (m_ps->m_currentSectionStyle.findDouble(PROP_PAGE_MARGIN_LEFT, value, unit) && unit == ABW_IN)
       propList.insert("fo:margin-left", value - m_ps->m_pageMarginLeft);
 
-    if (findDouble(_findSectionProperty("section-space-after"), value, unit) && unit == ABW_IN)
+    if (m_ps->m_currentSectionStyle.findDouble(PROP_SECTION_SPACE_AFTER, value, unit) && unit == ABW_IN)
       propList.insert("librevenge:margin-bottom", value);
 
-    std::string sValue = _findSectionProperty("dom-dir");
+    std::string sValue = _findSectionProperty(PROP_DOM_DIR);
     if (sValue.empty()) // try document default
-      sValue = _findDocumentProperty("dom-dir");
+      sValue = _findDocumentProperty(PROP_DOM_DIR);
     if (sValue == "ltr")
       propList.insert("style:writing-mode", "lr-tb");
     else if (sValue == "rtl")
       propList.insert("style:writing-mode", "rl-tb");
 
     int intValue(0);
-    if (findInt(_findSectionProperty("columns"), intValue) && intValue > 1)
+    if (m_ps->m_currentSectionStyle.findInt(PROP_COLUMNS, intValue) && intValue > 1)
     {
       librevenge::RVNGPropertyListVector columns;
       for (int i = 0; i < intValue; ++i)
@@ -1055,39 +1170,75 @@ void libabw::ABWContentCollector::_openHeader()
   m_ps->m_isHeaderOpened = true;
 }
 
-void libabw::ABWContentCollector::_fillParagraphProperties(librevenge::RVNGPropertyList &propList,
-                                                           bool isListElement)
+libabw::ABWPropertyListPool::Handle libabw::ABWContentCollector::_getParagraphProperties(bool isListElement)
+{
+  // As for spans, paragraphs with the same values of the properties that
+  // their property list depends on, and the same break, share it.
+  static const int paragraphProps[] =
+  {
+    PROP_BOT_COLOR, PROP_BOT_STYLE, PROP_BOT_THICKNESS, PROP_DOM_DIR, PROP_LEFT_COLOR, PROP_LEFT_STYLE,
+    PROP_LEFT_THICKNESS, PROP_LIBABW_OUTLINE_LEVEL, PROP_LINE_HEIGHT, PROP_MARGIN_BOTTOM, PROP_MARGIN_LEFT,
+    PROP_MARGIN_RIGHT, PROP_MARGIN_TOP, PROP_ORPHANS, PROP_RIGHT_COLOR, PROP_RIGHT_STYLE, PROP_RIGHT_THICKNESS,
+    PROP_TABSTOPS, PROP_TEXT_ALIGN, PROP_TEXT_INDENT, PROP_TOP_COLOR, PROP_TOP_STYLE, PROP_TOP_THICKNESS,
+    PROP_WIDOWS
+  };
+  m_propListCacheKey.assign(1, isListElement ? 'l' : 'p');
+  for (int id : paragraphProps)
+  {
+    m_propListCacheKey.append(_findParagraphProperty(id));
+    m_propListCacheKey.push_back('\0');
+  }
+  m_propListCacheKey.push_back(m_ps->m_deferredPageBreak ? 'P' : m_ps->m_deferredColumnBreak ? 'C' : '-');
+
+  ABWPropertyListPool::Handle propList = m_paragraphPropLists.find(m_propListCacheKey);
+  if (!propList)
+  {
+    librevenge::RVNGPropertyList newPropList;
+    _fillParagraphStyleProperties(newPropList, isListElement);
+    if (m_ps->m_deferredPageBreak)
+      newPropList.insert("fo:break-before", "page");
+    else if (m_ps->m_deferredColumnBreak)
+      newPropList.insert("fo:break-before", "column");
+    propList = m_paragraphPropLists.insert(m_propListCacheKey, newPropList);
+  }
+  m_ps->m_deferredPageBreak = false;
+  m_ps->m_deferredColumnBreak = false;
+  return propList;
+}
+
+void libabw::ABWContentCollector::_fillParagraphStyleProperties(librevenge::RVNGPropertyList &propList,
+                                                                bool isListElement)
 {
   ABWUnit unit(ABW_NONE);
   double value(0.0);
   int intValue(0);
   std::string sValue;
 
-  if (findDouble(_findParagraphProperty("margin-right"), value, unit) && unit == ABW_IN)
+  if (m_ps->m_currentParagraphStyle.findDouble(PROP_MARGIN_RIGHT, value, unit) && unit == ABW_IN)
     propList.insert("fo:margin-right", value);
 
-  if (findDouble(_findParagraphProperty("margin-top"), value, unit) && unit == ABW_IN)
+  if (m_ps->m_currentParagraphStyle.findDouble(PROP_MARGIN_TOP, value, unit) && unit == ABW_IN)
     propList.insert("fo:margin-top", value);
 
-  if (findDouble(_findParagraphProperty("margin-bottom"), value, unit) && unit == ABW_IN)
+  if (m_ps->m_currentParagraphStyle.findDouble(PROP_MARGIN_BOTTOM, value, unit) && unit == ABW_IN)
     propList.insert("fo:margin-bottom", value);
 
   if (!isListElement)
   {
-    if (findDouble(_findParagraphProperty("margin-left"), value, unit) && unit == ABW_IN)
+    if (m_ps->m_currentParagraphStyle.findDouble(PROP_MARGIN_LEFT, value, unit) && unit == ABW_IN)
       propList.insert("fo:margin-left", value);
 
-    if (findDouble(_findParagraphProperty("text-indent"), value, unit) && unit == ABW_IN)
+    if (m_ps->m_currentParagraphStyle.findDouble(PROP_TEXT_INDENT, value, unit) && unit == ABW_IN)
       propList.insert("fo:text-indent", value);
 
     // TODO: Numbered headings should probably not be handled as lists.
     // Just do not make them headings for now.
-    sValue = _findParagraphProperty("libabw:outline-level");
+    sValue = _findParagraphProperty(PROP_LIBABW_OUTLINE_LEVEL);
     if (!sValue.empty())
       propList.insert("text:outline-level", sValue.c_str());
   }
 
-  sValue = _findParagraphProperty("text-align");
+  sValue = _findParagraphProperty(PROP_TEXT_ALIGN);
   if (!sValue.empty())
   {
     if (sValue == "left")
@@ -1098,7 +1249,7 @@ void libabw::ABWContentCollector::_fillParagraphProperties(librevenge::RVNGPrope
       propList.insert("fo:text-align", sValue.c_str());
   }
 
-  sValue = _findParagraphProperty("line-height");
+  sValue = _findParagraphProperty(PROP_LINE_HEIGHT);
   if (!sValue.empty())
   {
     std::string propName("fo:line-height");
@@ -1117,31 +1268,25 @@ void libabw::ABWContentCollector::_fillParagraphProperties(librevenge::RVNGPrope
     }
   }
 
-  if (findInt(_findParagraphProperty("orphans"), intValue))
+  if (m_ps->m_currentParagraphStyle.findInt(PROP_ORPHANS, intValue))
     propList.insert("fo:orphans", intValue);
 
-  if (findInt(_findParagraphProperty("widows"), intValue))
+  if (m_ps->m_currentParagraphStyle.findInt(PROP_WIDOWS, intValue))
     propList.insert("fo:widows", intValue);
 
   librevenge::RVNGPropertyListVector tabStops;
-  parseTabStops(_findParagraphProperty("tabstops"), tabStops);
+  parseTabStops(_findParagraphProperty(PROP_TABSTOPS), tabStops);
 
   if (tabStops.count())
     propList.insert("style:tab-stops", tabStops);
 
-  sValue = _findParagraphProperty("dom-dir");
+  sValue = _findParagraphProperty(PROP_DOM_DIR);
   if (sValue == "ltr")
     propList.insert("style:writing-mode", "lr-tb");
   else if (sValue == "rtl")
     propList.insert("style:writing-mode", "rl-tb");
 
-  if (m_ps->m_deferredPageBreak)
-    propList.insert("fo:break-before", "page");
-  else if (m_ps->m_deferredColumnBreak)
-    propList.insert("fo:break-before", "column");
   _addBorderProperties(m_ps->m_currentParagraphStyle, propList);
-  m_ps->m_deferredPageBreak = false;
-  m_ps->m_deferredColumnBreak = false;
 }
 
 void libabw::ABWContentCollector::_openBlock()
@@ -1199,13 +1344,7 @@ void libabw::ABWContentCollector::_openParagraph()
 
     _changeList();
 
-    librevenge::RVNGPropertyList propList;
-    _fillParagraphProperties(propList, false);
-
-    m_ps->m_deferredPageBreak = false;
-    m_ps->m_deferredColumnBreak = false;
-
-    m_outputElements.addOpenParagraph(propList);
+    m_outputElements.addOpenParagraph(_getParagraphProperties(false));
 
     m_ps->m_isParagraphOpened = true;
     if (!m_ps->m_tableStates.empty())
@@ -1246,10 +1385,7 @@ void libabw::ABWContentCollector::_openListElement()
 
     _changeList();
 
-    librevenge::RVNGPropertyList propList;
-    _fillParagraphProperties(propList, true);
-
-    m_outputElements.addOpenListElement(propList);
+    m_outputElements.addOpenListElement(_getParagraphProperties(true));
 
     m_ps->m_isListElementOpened = true;
     if (!m_ps->m_tableStates.empty())
@@ -1258,95 +1394,120 @@ void libabw::ABWContentCollector::_openListElement()
   }
 }
 
-void libabw::ABWContentCollector::_openSpan()
+void libabw::ABWContentCollector::_fillSpanProperties(librevenge::RVNGPropertyList &propList)
 {
-  if (!m_ps->m_isSpanOpened)
-  {
-    _openBlock();
-
-    librevenge::RVNGPropertyList propList;
-    ABWUnit unit(ABW_NONE);
-    double value(0.0);
+  ABWUnit unit(ABW_NONE);
+  double value(0.0);
 
-    if (findDouble(_findCharacterProperty("font-size"), value, unit) && unit == ABW_IN)
-      propList.insert("fo:font-size", value);
+  if (_getCharacterPropertyMap(PROP_FONT_SIZE).findDouble(PROP_FONT_SIZE, value, unit) && unit == ABW_IN)
+    propList.insert("fo:font-size", value);
 
-    std::string sValue = _findCharacterProperty("font-family");
-    if (!sValue.empty())
-      propList.insert("style:font-name", sValue.c_str());
+  std::string sValue = _findCharacterProperty(PROP_FONT_FAMILY);
+  if (!sValue.empty())
+    propList.insert("style:font-name", sValue.c_str());
 
-    sValue = _findCharacterProperty("font-style");
-    if (!sValue.empty() && sValue != "normal")
-      propList.insert("fo:font-style", sValue.c_str());
+  sValue = _findCharacterProperty(PROP_FONT_STYLE);
+  if (!sValue.empty() && sValue != "normal")
+    propList.insert("fo:font-style", sValue.c_str());
 
-    sValue = _findCharacterProperty("font-weight");
-    if (!sValue.empty() && sValue != "normal")
-      propList.insert("fo:font-weight", sValue.c_str());
+  sValue = _findCharacterProperty(PROP_FONT_WEIGHT);
+  if (!sValue.empty() && sValue != "normal")
+    propList.insert("fo:font-weight", sValue.c_str());
 
-    sValue = _findCharacterProperty("display");
-    if (!sValue.empty() && sValue == "none")
-      propList.insert("text:display", "none");
+  sValue = _findCharacterProperty(PROP_DISPLAY);
+  if (!sValue.empty() && sValue == "none")
+    propList.insert("text:display", "none");
 
-    sValue = _findCharacterProperty("dir-override");
-    if (!sValue.empty() && sValue == "rtl")
-      propList.insert("style:writing-mode", "rl-tb");
+  sValue = _findCharacterProperty(PROP_DIR_OVERRIDE);
+  if (!sValue.empty() && sValue == "rtl")
+    propList.insert("style:writing-mode", "rl-tb");
 
-    sValue = _findCharacterProperty("text-decoration");
-    std::vector<std::string> listDecorations;
-    boost::split(listDecorations, sValue, boost::is_any_of(" "), boost::token_compress_on);
-    for (const auto &decoration : listDecorations)
+  sValue = _findCharacterProperty(PROP_TEXT_DECORATION);
+  std::vector<std::string> listDecorations;
+  boost::split(listDecorations, sValue, boost::is_any_of(" "), boost::token_compress_on);
+  for (const auto &decoration : listDecorations)
+  {
+    if (decoration == "underline")
     {
-      if (decoration == "underline")
-      {
-        propList.insert("style:text-underline-type", "single");
-        propList.insert("style:text-underline-style", "solid");
-      }
-      else if (decoration == "line-through")
-      {
-        propList.insert("style:text-line-through-type", "single");
-        propList.insert("style:text-line-through-style", "solid");
-      }
-      else if (decoration == "overline")
-      {
-        propList.insert("style:text-overline-type", "single");
-        propList.insert("style:text-overline-style", "solid");
-      }
+      propList.insert("style:text-underline-type", "single");
+      propList.insert("style:text-underline-style", "solid");
     }
-    sValue = getColor(_findCharacterProperty("color"));
-    if (!sValue.empty())
-      propList.insert("fo:color", sValue.c_str());
+    else if (decoration == "line-through")
+    {
+      propList.insert("style:text-line-through-type", "single");
+      propList.insert("style:text-line-through-style", "solid");
+    }
+    else if (decoration == "overline")
+    {
+      propList.insert("style:text-overline-type", "single");
+      propList.insert("style:text-overline-style", "solid");
+    }
+  }
+  sValue = getColor(_findCharacterProperty(PROP_COLOR));
+  if (!sValue.empty())
+    propList.insert("fo:color", sValue.c_str());
 
-    sValue = getColor(_findCharacterProperty("bgcolor"));
-    if (!sValue.empty())
-      propList.insert("fo:background-color", sValue.c_str());
+  sValue = getColor(_findCharacterProperty(PROP_BGCOLOR));
+  if (!sValue.empty())
+    propList.insert("fo:background-color", sValue.c_str());
 
-    sValue = _findCharacterProperty("text-position");
-    if (sValue == "subscript")
-      propList.insert("style:text-position", "sub");
-    else if (sValue == "superscript")
-      propList.insert("style:text-position", "super");
+  sValue = _findCharacterProperty(PROP_TEXT_POSITION);
+  if (sValue == "subscript")
+    propList.insert("style:text-position", "sub");
+  else if (sValue == "superscript")
+    propList.insert("style:text-position", "super");
 
-    sValue = _findCharacterProperty("lang");
-    if (sValue.empty()) // try document default
-      sValue = _findDocumentProperty("lang");
+  sValue = _findCharacterProperty(PROP_LANG);
+  if (sValue.empty()) // try document default
+    sValue = _findDocumentProperty(PROP_LANG);
 
-    if (!sValue.empty())
+  if (!sValue.empty())
+  {
+    optional<std::string> lang;
+    optional<std::string> country;
+    optional<std::string> script;
+
+    parseLang(sValue, lang, country, script);
+
+    if (bool(lang))
+      propList.insert("fo:language", get(lang).c_str());
+    if (bool(country))
+      propList.insert("fo:country", get(country).c_str());
+    if (bool(script))
+      propList.insert("fo:script", get(script).c_str());
+  }
+
+  // do we need to check "font-stretch" here or it is always equal to normal ?
+}
+
+void libabw::ABWContentCollector::_openSpan()
+{
+  if (!m_ps->m_isSpanOpened)
+  {
+    _openBlock();
+
+    // The property list only depends on these properties, so spans that
+    // have the same values of them share a property list.
+    static const int spanProps[] =
+    {
+      PROP_BGCOLOR, PROP_COLOR, PROP_DIR_OVERRIDE, PROP_DISPLAY, PROP_FONT_FAMILY, PROP_FONT_SIZE,
+      PROP_FONT_STYLE, PROP_FONT_WEIGHT, PROP_LANG, PROP_TEXT_DECORATION, PROP_TEXT_POSITION
+    };
+    m_propListCacheKey.assign(1, 's');
+    for (int id : spanProps)
     {
-      optional<std::string> lang;
-      optional<std::string> country;
-      optional<std::string> script;
-
-      parseLang(sValue, lang, country, script);
-
-      if (bool(lang))
-        propList.insert("fo:language", get(lang).c_str());
-      if (bool(country))
-        propList.insert("fo:country", get(country).c_str());
-      if (bool(script))
-        propList.insert("fo:script", get(script).c_str());
+      m_propListCacheKey.append(_findCharacterProperty(id));
+      m_propListCacheKey.push_back('\0');
     }
+    m_propListCacheKey.append(_findDocumentProperty(PROP_LANG));
 
-    // do we need to check "font-stretch" here or it is always equal to normal ?
+    ABWPropertyListPool::Handle propList = m_spanPropLists.find(m_propListCacheKey);
+    if (!propList)
+    {
+      librevenge::RVNGPropertyList newPropList;
+      _fillSpanProperties(newPropList);
+      propList = m_spanPropLists.insert(m_propListCacheKey, newPropList);
+    }
     m_outputElements.addOpenSpan(propList);
   }
   m_ps->m_isSpanOpened = true;
@@ -1458,26 +1619,12 @@ void libabw::ABWContentCollector::_openTable()
   m_ps->m_deferredPageBreak = false;
   m_ps->m_deferredColumnBreak = false;
 
-  librevenge::RVNGPropertyListVector tmpColumns;
-  parseTableColumns(_findTableProperty("table-column-props"), tmpColumns);
-  auto numColumns = unsigned(tmpColumns.count());
-  auto iter = m_tableSizes.find(m_ps->m_tableStates.top().m_currentTableId);
-  if (iter != m_tableSizes.end())
-    numColumns = unsigned(iter->second);
   librevenge::RVNGPropertyListVector columns;
-  for (unsigned j = 0; j < numColumns; ++j)
-  {
-    if (j < tmpColumns.count())
-      columns.append(tmpColumns[j]);
-    else
-      columns.append(librevenge::RVNGPropertyList());
-  }
-  if (columns.count())
-    propList.insert("librevenge:table-columns", columns);
+  parseTableColumns(_findTableProperty(PROP_TABLE_COLUMN_PROPS), columns);
 
   ABWUnit unit(ABW_NONE);
   double value(0.0);
-  if (findDouble(_findTableProperty("table-column-leftpos"), value, unit) && unit == ABW_IN)
+  if (m_ps->m_tableStates.top().m_currentTableProperties.findDouble(PROP_TABLE_COLUMN_LEFTPOS, value, unit) && unit == ABW_IN)
   {
     propList.insert("fo:margin-left", value);
     propList.insert("table:align", "margins");
@@ -1485,7 +1632,7 @@ void libabw::ABWContentCollector::_openTable()
   else
     propList.insert("table:align", "left");
 
-  m_outputElements.addOpenTable(propList);
+  m_outputElements.addOpenTable(propList, columns, m_ps->m_tableStates.top().m_currentTableId, m_tableSizes);
 
   m_ps->m_tableStates.top().m_currentTableRow = (-1);
   m_ps->m_tableStates.top().m_currentTableCol = (-1);
@@ -1544,14 +1691,14 @@ void libabw::ABWContentCollector::_openTableCell()
   propList.insert("librevenge:row", m_ps->m_tableStates.top().m_currentTableRow);
 
   int rightAttach(0);
-  if (findInt(_findCellProperty("right-attach"), rightAttach))
+  if (m_ps->m_tableStates.top().m_currentCellProperties.findInt(PROP_RIGHT_ATTACH, rightAttach))
     propList.insert("table:number-columns-spanned", rightAttach - m_ps->m_tableStates.top().m_currentTableCol);
 
   int botAttach(0);
-  if (findInt(_findCellProperty("bot-attach"), botAttach))
+  if (m_ps->m_tableStates.top().m_currentCellProperties.findInt(PROP_BOT_ATTACH, botAttach))
     propList.insert("table:number-rows-spanned", botAttach - m_ps->m_tableStates.top().m_currentTableRow);
 
-  std::string bgColor = getColor(_findCellProperty("background-color"));
+  std::string bgColor = getColor(_findCellProperty(PROP_BACKGROUND_COLOR));
   if (!bgColor.empty())
     propList.insert("fo:background-color", bgColor.c_str());
 
@@ -1591,10 +1738,7 @@ void libabw::ABWContentCollector::openFoot(const char *id)
     propList.insert("librevenge:number", id);
   m_outputElements.addOpenFootnote(propList);
 
-  m_parsingStates.push(m_ps);
-  m_ps = std::make_shared<ABWContentParsingState>();
-
-  m_ps->m_isNote = true;
+  _openNoteState();
 }
 
 void libabw::ABWContentCollector::closeFoot()
@@ -1605,11 +1749,7 @@ void libabw::ABWContentCollector::closeFoot()
 
   m_outputElements.addCloseFootnote();
 
-  if (!m_parsingStates.empty())
-  {
-    m_ps = m_parsingStates.top();
-    m_parsingStates.pop();
-  }
+  _closeNoteState();
 }
 
 void libabw::ABWContentCollector::openEndnote(const char *id)
@@ -1623,10 +1763,7 @@ void libabw::ABWContentCollector::openEndnote(const char *id)
     propList.insert("librevenge:number", id);
   m_outputElements.addOpenEndnote(propList);
 
-  m_parsingStates.push(m_ps);
-  m_ps = std::make_shared<ABWContentParsingState>();
-
-  m_ps->m_isNote = true;
+  _openNoteState();
 }
 
 void libabw::ABWContentCollector::closeEndnote()
@@ -1637,8 +1774,29 @@ void libabw::ABWContentCollector::closeEndnote()
 
   m_outputElements.addCloseEndnote();
 
+  _closeNoteState();
+}
+
+void libabw::ABWContentCollector::_openNoteState()
+{
+  m_parsingStates.push(m_ps);
+  if (m_spareParsingStates.empty())
+    m_ps = std::make_shared<ABWContentParsingState>();
+  else
+  {
+    m_ps = m_spareParsingStates.back();
+    m_spareParsingStates.pop_back();
+    m_ps->clear();
+  }
+
+  m_ps->m_isNote = true;
+}
+
+void libabw::ABWContentCollector::_closeNoteState()
+{
   if (!m_parsingStates.empty())
   {
+    m_spareParsingStates.push_back(m_ps);
     m_ps = m_parsingStates.top();
     m_parsingStates.pop();
   }
@@ -2018,7 +2176,7 @@ void libabw::ABWContentCollector::openCell(const char *props)
   {
     if (props)
       parsePropString(props, m_ps->m_tableStates.top().m_currentCellProperties);
-    const int currentRow(getCellPos("top-attach", "bottom-attach", m_ps->m_tableStates.top().m_currentTableRow + 1));
+    const int currentRow(getCellPos(PROP_TOP_ATTACH, PROP_BOTTOM_ATTACH, m_ps->m_tableStates.top().m_currentTableRow + 1));
 
     while (m_ps->m_tableStates.top().m_currentTableRow < currentRow)
     {
@@ -2028,16 +2186,16 @@ void libabw::ABWContentCollector::openCell(const char *props)
     }
 
     m_ps->m_tableStates.top().m_currentTableCol =
-      getCellPos("left-attach", "right-attach", m_ps->m_tableStates.top().m_currentTableCol + 1);
+      getCellPos(PROP_LEFT_ATTACH, PROP_RIGHT_ATTACH, m_ps->m_tableStates.top().m_currentTableCol + 1);
   }
 }
 
-int libabw::ABWContentCollector::getCellPos(const char *startProp, const char *endProp, int defStart)
+int libabw::ABWContentCollector::getCellPos(const int startProp, const int endProp, int defStart)
 {
   int startAttach(0);
-  const bool haveStart(findInt(_findCellProperty(startProp), startAttach));
+  const bool haveStart(m_ps->m_tableStates.top().m_currentCellProperties.findInt(startProp, startAttach));
   int endAttach(0);
-  const bool haveEnd(findInt(_findCellProperty(endProp), endAttach));
+  const bool haveEnd(m_ps->m_tableStates.top().m_currentCellProperties.findInt(endProp, endAttach));
 
   int newStartAttach(startAttach);
 
@@ -2080,39 +2238,35 @@ void libabw::ABWContentCollector::openFrame(const char *props, const char *image
   ABWPropertyMap propMap;
   if (props)
     parsePropString(props, propMap);
-  ABWPropertyMap::const_iterator iter;
+  const std::string *prop;
 
   librevenge::RVNGPropertyList propList;
   ABWUnit unit(ABW_NONE);
   double value(0.0);
   // size
-  iter = propMap.find("frame-height");
-  if (iter != propMap.end() && findDouble(iter->second, value, unit) && ABW_IN == unit)
+  if (propMap.findDouble(PROP_FRAME_HEIGHT, value, unit) && ABW_IN == unit)
     propList.insert("svg:height", value);
-  iter = propMap.find("frame-width");
-  if (iter != propMap.end() && findDouble(iter->second, value, unit) && ABW_IN == unit)
+  if (propMap.findDouble(PROP_FRAME_WIDTH, value, unit) && ABW_IN == unit)
     propList.insert("svg:width", value);
   // position
   bool isParagraph=true;
-  iter = propMap.find("position-to");
-  if (iter != propMap.end())
+  prop = propMap.find(PROP_POSITION_TO);
+  if (prop)
   {
-    if (iter->second=="page-above-text")
+    if (*prop=="page-above-text")
       isParagraph=false;
-    else if (iter->second=="column-above-text")
+    else if (*prop=="column-above-text")
       /* unsure how to retrieve that, so check if the page positions
          are defined, if yes, use a page anchor. */
-      isParagraph=(propMap.find("frame-page-ypos")==propMap.end());
-    else if (iter->second!="block-above-text")
+      isParagraph=!propMap.find(PROP_FRAME_PAGE_YPOS);
+    else if (*prop!="block-above-text")
     {
-      ABW_DEBUG_MSG(("libabw::ABWContentCollector::openFrame: sorry, unknown pos: %s asume paragraph\n", iter->second.c_str()));
+      ABW_DEBUG_MSG(("libabw::ABWContentCollector::openFrame: sorry, unknown pos: %s asume paragraph\n", prop->c_str()));
     }
   }
-  iter = propMap.find(isParagraph ? "xpos" : "frame-page-xpos");
-  if (iter != propMap.end() && findDouble(iter->second, value, unit) && ABW_IN == unit)
+  if (propMap.findDouble(isParagraph ? PROP_XPOS : PROP_FRAME_PAGE_XPOS, value, unit) && ABW_IN == unit)
     propList.insert("svg:x", value);
-  iter = propMap.find(isParagraph ? "ypos" : "frame-page-ypos");
-  if (iter != propMap.end() && findDouble(iter->second, value, unit) && ABW_IN == unit)
+  if (propMap.findDouble(isParagraph ? PROP_YPOS : PROP_FRAME_PAGE_YPOS, value, unit) && ABW_IN == unit)
     propList.insert("svg:y", value);
   if (!isParagraph)
   {
@@ -2121,76 +2275,68 @@ void libabw::ABWContentCollector::openFrame(const char *props, const char *image
   }
   if (!isParagraph)
   {
-    iter = propMap.find("frame-pref-page");
     int page=0;
-    if (iter != propMap.end() && findInt(iter->second, page))
+    if (propMap.findInt(PROP_FRAME_PREF_PAGE, page))
       propList.insert("text:anchor-page-number", page+1);
   }
   // style
   int intValue;
-  iter = propMap.find("bg-style"); // 0: none, 1: color=background-color
-  if (iter != propMap.end() && findInt(iter->second, intValue) && intValue==1)
+  if (propMap.findInt(PROP_BG_STYLE, intValue) && intValue==1) // 0: none, 1: color=background-color
   {
-    iter = propMap.find("background-color");
-    if (iter != propMap.end())
+    prop = propMap.find(PROP_BACKGROUND_COLOR);
+    if (prop)
     {
       std::string color("#");
-      color+=iter->second;
+      color+=*prop;
       propList.insert("fo:background-color", color.c_str());
     }
   }
   propList.insert("text:anchor-type", isParagraph ? "paragraph" : "page");
-  iter = propMap.find("wrap-mode");
-  if (iter != propMap.end())
+  prop = propMap.find(PROP_WRAP_MODE);
+  if (prop)
   {
-    if (iter->second=="wrapped-to-left")
+    if (*prop=="wrapped-to-left")
       propList.insert("style:wrap", "left");
-    else if (iter->second=="wrapped-to-right")
+    else if (*prop=="wrapped-to-right")
       propList.insert("style:wrap", "right");
-    else if (iter->second=="wrapped-to-both")
+    else if (*prop=="wrapped-to-both")
       propList.insert("style:wrap", "parallel");
-    else if (iter->second=="above-text")
+    else if (*prop=="above-text")
     {
       propList.insert("style:wrap", "dynamic");
       propList.insert("style:run-through", "foreground");
     }
-    else if (iter->second=="below-text")
+    else if (*prop=="below-text")
     {
       propList.insert("style:wrap", "dynamic");
       propList.insert("style:run-through", "background");
     }
     else
     {
-      ABW_DEBUG_MSG(("libabw::ABWContentCollector::openFrame: sorry, unknown wrap mode: %s\n", iter->second.c_str()));
+      ABW_DEBUG_MSG(("libabw::ABWContentCollector::openFrame: sorry, unknown wrap mode: %s\n", prop->c_str()));
     }
   }
   m_ps->m_isPageFrame=!isParagraph;
   m_outputElements.addOpenFrame(propList);
 
-  iter = propMap.find("frame-type");
-  if (iter==propMap.end())
+  prop = propMap.find(PROP_FRAME_TYPE);
+  if (!prop)
   {
     ABW_DEBUG_MSG(("libabw::ABWContentCollector::openFrame: can not find the frame type\n"));
   }
-  else if (iter->second=="image")
+  else if (*prop=="image")
   {
     m_ps->m_parsingContext=ABW_FRAME_IMAGE;
-    auto imIter = m_data.end();
-    if (imageId) imIter= m_data.find(imageId);
-    if (imIter==m_data.end())
+    if (!imageId)
     {
       ABW_DEBUG_MSG(("libabw::ABWContentCollector::openFrame: can not find the image\n"));
       return;
     }
-
-    propList.clear();
-    propList.insert("librevenge:mime-type", imIter->second.m_mimeType);
-    propList.insert("office:binary-data", imIter->second.m_binaryData);
-    m_outputElements.addInsertBinaryObject(propList);
-
+    // the data are usually stored after the frame, so they are looked up when written
+    m_outputElements.addInsertImageData(imageId, m_data);
     return;
   }
-  else if (iter->second=="textbox")
+  else if (*prop=="textbox")
   {
     m_ps->m_parsingContext=ABW_FRAME_TEXTBOX;
     propList.clear();
@@ -2200,7 +2346,7 @@ void libabw::ABWContentCollector::openFrame(const char *props, const char *image
   else
   {
     m_ps->m_parsingContext=ABW_FRAME_UNKNOWN;
-    ABW_DEBUG_MSG(("libabw::ABWContentCollector::openFrame: sorry, unknown frame type: %s\n", iter->second.c_str()));
+    ABW_DEBUG_MSG(("libabw::ABWContentCollector::openFrame: sorry, unknown frame type: %s\n", prop->c_str()));
   }
 }
 
@@ -2232,7 +2378,13 @@ void libabw::ABWContentCollector::closeFrame(libabw::ABWOutputElements *(&elemen
 void libabw::ABWContentCollector::addFrameElements(ABWOutputElements &elements, bool pageFrame)
 {
   if (pageFrame)
-    m_pageOutputElements.splice(elements);
+  {
+    // the body is not kept until the end when streaming, so the page frames can not be written before it
+    if (m_isStreaming)
+      m_outputElements.splice(elements);
+    else
+      m_pageOutputElements.splice(elements);
+  }
   else
   {
     _openBlock();
@@ -2254,33 +2406,21 @@ void libabw::ABWContentCollector::insertImage(const char *dataid, const char *pr
     parsePropString(props, properties);
   if (dataid)
   {
-    auto iter = m_data.find(dataid);
-    if (iter != m_data.end())
-    {
-      librevenge::RVNGPropertyList propList;
-      ABWUnit unit(ABW_NONE);
-      double value(0.0);
-      ABWPropertyMap::const_iterator i = properties.find("height");
-      if (i != properties.end() && findDouble(i->second, value, unit) && ABW_IN == unit)
-        propList.insert("svg:height", value);
-      else
-        propList.insert("fo:min-height", 1.0);
-      i = properties.find("width");
-      if (i != properties.end() && findDouble(i->second, value, unit) && ABW_IN == unit)
-        propList.insert("svg:width", value);
-      else
-        propList.insert("fo:min-width", 1.0);
-      propList.insert("text:anchor-type", "as-char");
-
-      m_outputElements.addOpenFrame(propList);
-
-      propList.clear();
-      propList.insert("librevenge:mime-type", iter->second.m_mimeType);
-      propList.insert("office:binary-data", iter->second.m_binaryData);
-      m_outputElements.addInsertBinaryObject(propList);
+    librevenge::RVNGPropertyList propList;
+    ABWUnit unit(ABW_NONE);
+    double value(0.0);
+    if (properties.findDouble(PROP_HEIGHT, value, unit) && ABW_IN == unit)
+      propList.insert("svg:height", value);
+    else
+      propList.insert("fo:min-height", 1.0);
+    if (properties.findDouble(PROP_WIDTH, value, unit) && ABW_IN == unit)
+      propList.insert("svg:width", value);
+    else
+      propList.insert("fo:min-width", 1.0);
+    propList.insert("text:anchor-type", "as-char");
 
-      m_outputElements.addCloseFrame();
-    }
+    // the image is only output if its data exist; they are looked up when written
+    m_outputElements.addInsertImage(propList, dataid, m_data);
   }
 }
 
@@ -2338,15 +2478,8 @@ void libabw::ABWContentCollector::_recurseListLevels(int oldLevel, int newLevel,
     else
       _writeOutDummyListLevels(oldLevel, newLevel-1);
     m_ps->m_listLevels.push(std::make_pair(newLevel, iter->second));
-    librevenge::RVNGPropertyList propList;
-    iter->second->writeOut(propList);
-    // osnola: use the element list id if set, if not use newListId
-    propList.insert("librevenge:list-id",
-                    iter->second->m_listId ? iter->second->m_listId : newListId);
-    if (iter->second->getType() == ABW_UNORDERED)
-      m_outputElements.addOpenUnorderedListLevel(propList);
-    else
-      m_outputElements.addOpenOrderedListLevel(propList);
+    // the level properties are completed by the following paragraphs, so they are written out at the end
+    m_outputElements.addOpenListLevel(iter->second, newListId);
   }
 }
 
@@ -2374,7 +2507,30 @@ void libabw::ABWContentCollector::addMetadataEntry(const char *const key, const
   assert(key);
   assert(value);
 
-  m_metadata[key] = value;
+  m_metadata.set(key, value);
+}
+
+bool libabw::ABWContentCollector::reset()
+{
+  // the property list caches only depend on property values, so they stay valid
+  while (!m_parsingStates.empty())
+  {
+    m_ps = m_parsingStates.top();
+    m_parsingStates.pop();
+  }
+  m_ps->clear();
+  m_metadata.clear();
+  m_tableCounter = 0;
+  m_outputElements.clear();
+  m_pageOutputElements.clear();
+  m_dummyListElements.clear();
+  m_isOutputComplete = true;
+  return true;
+}
+
+bool libabw::ABWContentCollector::isOutputComplete() const
+{
+  return m_isOutputComplete;
 }
 
 /* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -14,6 +14,7 @@
 #include <vector>
 #include <stack>
 #include <set>
+#include <unordered_map>
 
 #include <librevenge/librevenge.h>
 #include "ABWOutputElements.h"
@@ -41,6 +42,31 @@ struct ABWStyle
   ABWPropertyMap properties;
 };
 
+/* The text styles and the document properties, shared by the content
+   collectors of the document and of all its frames.
+ */
+class ABWStyleRegistry
+{
+public:
+  ABWStyleRegistry();
+
+  void addTextStyle(const char *name, const ABWStyle &style);
+  // the properties of a text style, including the inherited ones
+  const ABWPropertyMap &getTextStyleProperties(const char *name);
+
+  void collectDocumentProperties(const char *props);
+  const ABWPropertyMap &getDocumentProperties() const;
+
+private:
+  void _recurseTextProperties(const char *name, ABWPropertyMap &styleProps);
+
+  std::set<std::string> m_dontLoop;
+  std::map<std::string, ABWStyle> m_textStyles;
+  /// text styles resolved by getTextStyleProperties, by name
+  std::unordered_map<std::string, ABWPropertyMap> m_resolvedTextStyles;
+  ABWPropertyMap m_documentProperties;
+};
+
 struct ABWContentTableState
 {
   ABWContentTableState();
@@ -66,6 +92,8 @@ struct ABWContentParsingState
   ABWContentParsingState();
   ABWContentParsingState(const ABWContentParsingState &ps);
   ~ABWContentParsingState();
+  //! reset to the initial state, keeping the allocated storage
+  void clear();
 
   bool m_isDocumentStarted;
   bool m_isPageSpanOpened;
@@ -119,8 +147,11 @@ class ABWContentCollector : public ABWCollector
 {
 public:
   ABWContentCollector(librevenge::RVNGTextInterface *iface, const std::map<int, int> &tableSizes,
-                      const std::map<std::string, ABWData> &data,
-                      const std::map<int, std::shared_ptr<ABWListElement>> &listElements);
+                      ABWDataMap &data,
+                      const std::map<int, std::shared_ptr<ABWListElement>> &listElements,
+                      ABWStyleRegistry &styles, ABWPropertyListPool &spanPropLists, ABWPropertyListPool &paragraphPropLists,
+                      ABWOutputElements *documentElements, bool streaming, unsigned long spillThreshold,
+                      bool mergeEvents);
   ~ABWContentCollector() override;
 
   // collector functions
@@ -154,6 +185,10 @@ public:
   void collectList(const char *, const char *, const char *, const char *, const char *, const char *) override {}
 
   void collectData(const char *name, const char *mimeType, const librevenge::RVNGBinaryData &data) override;
+  bool isDataCollected() const override
+  {
+    return false;
+  }
   void collectHeaderFooter(const char *id, const char *type) override;
 
   void openTable(const char *props) override;
@@ -167,13 +202,16 @@ public:
 
   void addMetadataEntry(const char *name, const char *value) override;
 
+  bool reset() override;
+  bool isOutputComplete() const override;
+
 private:
   ABWContentCollector(const ABWContentCollector &);
   ABWContentCollector &operator=(const ABWContentCollector &);
 
   void _setMetadata();
 
-  void _addBorderProperties(const std::map<std::string, std::string> &map, librevenge::RVNGPropertyList &propList, const std::string &defaultUndefBorderProp="");
+  void _addBorderProperties(const ABWPropertyMap &map, librevenge::RVNGPropertyList &propList, const std::string &defaultUndefBorderProp="");
 
   void _openPageSpan();
   void _closePageSpan();
@@ -207,41 +245,65 @@ private:
   void _openTableCell();
   void _closeTableCell();
 
+  //! switch to a fresh parsing state for a footnote or an endnote
+  void _openNoteState();
+  //! return to the parsing state from before the note
+  void _closeNoteState();
+
+  //! when streaming, write the events which can not change any more
+  void _flushOutput();
+
   void _openHeader();
   void _closeHeader();
   void _openFooter();
   void _closeFooter();
 
-  void _recurseTextProperties(const char *name, ABWPropertyMap &styleProps);
-  std::string _findDocumentProperty(const char *name);
-  std::string _findParagraphProperty(const char *name);
-  std::string _findCharacterProperty(const char *name);
-  std::string _findTableProperty(const char *name);
-  std::string _findCellProperty(const char *name);
-  std::string _findSectionProperty(const char *name);
+  const std::string &_findDocumentProperty(int id);
+  const std::string &_findParagraphProperty(int id);
+  const std::string &_findCharacterProperty(int id);
+  const ABWPropertyMap &_getCharacterPropertyMap(int id);
+  const std::string &_findTableProperty(int id);
+  const std::string &_findCellProperty(int id);
+  const std::string &_findSectionProperty(int id);
   std::string _findMetadataEntry(const char *name);
 
-  void _fillParagraphProperties(librevenge::RVNGPropertyList &propList, bool isListElement);
+  ABWPropertyListPool::Handle _getParagraphProperties(bool isListElement);
+  void _fillParagraphStyleProperties(librevenge::RVNGPropertyList &propList, bool isListElement);
+  void _fillSpanProperties(librevenge::RVNGPropertyList &propList);
   bool _convertFieldDTFormat(std::string const &dtFormat, librevenge::RVNGPropertyListVector &propVect);
 
-  int getCellPos(const char *startProp, const char *endProp, int defStart);
+  int getCellPos(int startProp, int endProp, int defStart);
 
   std::shared_ptr<ABWContentParsingState> m_ps;
   librevenge::RVNGTextInterface *m_iface;
   std::stack<std::shared_ptr<ABWContentParsingState> > m_parsingStates;
-  std::set<std::string> m_dontLoop;
-  std::map<std::string, ABWStyle> m_textStyles;
+  /// parsing states of the closed notes, reused by the next notes
+  std::vector<std::shared_ptr<ABWContentParsingState> > m_spareParsingStates;
+  /// the text styles and document properties, shared with the collectors of the frames
+  ABWStyleRegistry &m_styles;
+  /// span property lists, by the values of the properties they depend on
+  ABWPropertyListPool &m_spanPropLists;
+  /// paragraph and list element property lists, likewise
+  ABWPropertyListPool &m_paragraphPropLists;
+  std::string m_propListCacheKey;
+  /// copy of the inserted text, split in pieces in place
+  std::string m_textBuffer;
 
-  ABWPropertyMap m_documentStyle;
   ABWPropertyMap m_metadata;
 
-  const std::map<std::string, ABWData> &m_data;
+  ABWDataMap &m_data;
   const std::map<int, int> &m_tableSizes;
   int m_tableCounter;
   ABWOutputElements m_outputElements;
   ABWOutputElements m_pageOutputElements;
   const std::map<int, std::shared_ptr<ABWListElement>> &m_listElements;
   std::vector<std::shared_ptr<ABWListElement>> m_dummyListElements;
+  /// startDocument and metadata, only recorded by the collector of the document; 0 in the frames
+  ABWOutputElements *m_documentElements;
+  /// whether the output is written while the document is parsed
+  bool m_isStreaming;
+  /// false once a part of the output could not be read back from the spill file
+  bool m_isOutputComplete;
 };
 
 } // namespace libabw
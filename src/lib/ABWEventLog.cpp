@@ -0,0 +1,458 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libabw project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <string.h>
+
+#include "ABWEventLog.h"
+#include "libabw_internal.h"
+
+namespace libabw
+{
+
+namespace
+{
+
+//! number of arguments of each event type
+static const unsigned char EVENT_ARG_COUNTS[] = { 4, 1, 5, 9, 2, 4, 0, 0, 1, 0, 1, 0, 1, 0, 2, 0, 0, 0, 0, 0, 0, 0, 1, 2, 6, 2, 1, 0, 1, 0, 4, 0, 2 };
+
+static void appendLength(std::vector<char> &buffer, unsigned long length)
+{
+  while (length >= 0x80)
+  {
+    buffer.push_back(char((length & 0x7f) | 0x80));
+    length >>= 7;
+  }
+  buffer.push_back(char(length));
+}
+
+static unsigned long readLength(const std::vector<char> &buffer, unsigned long &pos)
+{
+  unsigned long length = 0;
+  unsigned shift = 0;
+  while (pos < buffer.size())
+  {
+    const auto c = (unsigned char) buffer[pos++];
+    length |= (unsigned long)(c & 0x7f) << shift;
+    if (!(c & 0x80))
+      break;
+    shift += 7;
+  }
+  return length;
+}
+
+} // anonymous namespace
+
+} // namespace libabw
+
+libabw::ABWLoggedEvent::ABWLoggedEvent() :
+  m_type(ABW_EVENT_COLLECT_TEXT_STYLE),
+  m_args()
+{
+}
+
+void libabw::ABWLoggedEvent::dispatch(ABWCollector &collector) const
+{
+  switch (m_type)
+  {
+  case ABW_EVENT_COLLECT_TEXT_STYLE:
+    collector.collectTextStyle(m_args[0], m_args[1], m_args[2], m_args[3]);
+    break;
+  case ABW_EVENT_COLLECT_DOCUMENT_PROPERTIES:
+    collector.collectDocumentProperties(m_args[0]);
+    break;
+  case ABW_EVENT_COLLECT_PARAGRAPH_PROPERTIES:
+    collector.collectParagraphProperties(m_args[0], m_args[1], m_args[2], m_args[3], m_args[4]);
+    break;
+  case ABW_EVENT_COLLECT_SECTION_PROPERTIES:
+    collector.collectSectionProperties(m_args[0], m_args[1], m_args[2], m_args[3], m_args[4], m_args[5], m_args[6], m_args[7], m_args[8]);
+    break;
+  case ABW_EVENT_COLLECT_CHARACTER_PROPERTIES:
+    collector.collectCharacterProperties(m_args[0], m_args[1]);
+    break;
+  case ABW_EVENT_COLLECT_PAGE_SIZE:
+    collector.collectPageSize(m_args[0], m_args[1], m_args[2], m_args[3]);
+    break;
+  case ABW_EVENT_CLOSE_PARAGRAPH_OR_LIST_ELEMENT:
+    collector.closeParagraphOrListElement();
+    break;
+  case ABW_EVENT_CLOSE_SPAN:
+    collector.closeSpan();
+    break;
+  case ABW_EVENT_OPEN_LINK:
+    collector.openLink(m_args[0]);
+    break;
+  case ABW_EVENT_CLOSE_LINK:
+    collector.closeLink();
+    break;
+  case ABW_EVENT_OPEN_FOOT:
+    collector.openFoot(m_args[0]);
+    break;
+  case ABW_EVENT_CLOSE_FOOT:
+    collector.closeFoot();
+    break;
+  case ABW_EVENT_OPEN_ENDNOTE:
+    collector.openEndnote(m_args[0]);
+    break;
+  case ABW_EVENT_CLOSE_ENDNOTE:
+    collector.closeEndnote();
+    break;
+  case ABW_EVENT_OPEN_FIELD:
+    collector.openField(m_args[0], m_args[1]);
+    break;
+  case ABW_EVENT_CLOSE_FIELD:
+    collector.closeField();
+    break;
+  case ABW_EVENT_END_SECTION:
+    collector.endSection();
+    break;
+  case ABW_EVENT_START_DOCUMENT:
+    collector.startDocument();
+    break;
+  case ABW_EVENT_END_DOCUMENT:
+    collector.endDocument();
+    break;
+  case ABW_EVENT_INSERT_LINE_BREAK:
+    collector.insertLineBreak();
+    break;
+  case ABW_EVENT_INSERT_COLUMN_BREAK:
+    collector.insertColumnBreak();
+    break;
+  case ABW_EVENT_INSERT_PAGE_BREAK:
+    collector.insertPageBreak();
+    break;
+  case ABW_EVENT_INSERT_TEXT:
+    collector.insertText(m_args[0]);
+    break;
+  case ABW_EVENT_INSERT_IMAGE:
+    collector.insertImage(m_args[0], m_args[1]);
+    break;
+  case ABW_EVENT_COLLECT_LIST:
+    collector.collectList(m_args[0], m_args[1], m_args[2], m_args[3], m_args[4], m_args[5]);
+    break;
+  case ABW_EVENT_COLLECT_HEADER_FOOTER:
+    collector.collectHeaderFooter(m_args[0], m_args[1]);
+    break;
+  case ABW_EVENT_OPEN_TABLE:
+    collector.openTable(m_args[0]);
+    break;
+  case ABW_EVENT_CLOSE_TABLE:
+    collector.closeTable();
+    break;
+  case ABW_EVENT_OPEN_CELL:
+    collector.openCell(m_args[0]);
+    break;
+  case ABW_EVENT_CLOSE_CELL:
+    collector.closeCell();
+    break;
+  case ABW_EVENT_OPEN_FRAME:
+    collector.openFrame(m_args[0], m_args[1], m_args[2], m_args[3]);
+    break;
+  case ABW_EVENT_CLOSE_FRAME:
+  {
+    ABWOutputElements *elements = nullptr;
+    bool pageFrame = false;
+    collector.closeFrame(elements, pageFrame);
+    break;
+  }
+  case ABW_EVENT_ADD_METADATA_ENTRY:
+    collector.addMetadataEntry(m_args[0], m_args[1]);
+    break;
+  default:
+    break;
+  }
+}
+
+libabw::ABWEventLog::ABWEventLog(ABWCollector *collector, unsigned long maxSize) :
+  m_collector(collector),
+  m_maxSize(maxSize),
+  m_isComplete(true),
+  m_eventCount(0),
+  m_size(0),
+  m_buffer()
+{
+}
+
+libabw::ABWEventLog::~ABWEventLog()
+{
+}
+
+bool libabw::ABWEventLog::readEvent(unsigned long &pos, ABWLoggedEvent &event) const
+{
+  if (pos >= m_buffer.size())
+    return false;
+  const auto type = (unsigned char) m_buffer[pos++];
+  if (type >= ABW_NUM_ELEMENTS(EVENT_ARG_COUNTS))
+    return false;
+  event.m_type = ABWEventType(type);
+  for (unsigned i = 0; i < ABW_NUM_ELEMENTS(event.m_args); ++i)
+  {
+    event.m_args[i] = nullptr;
+    if (i >= EVENT_ARG_COUNTS[type])
+      continue;
+    const unsigned long length = readLength(m_buffer, pos);
+    if (!length)
+      continue;
+    if (pos + length > m_buffer.size())
+      return false;
+    event.m_args[i] = &m_buffer[pos];
+    pos += length;
+  }
+  return true;
+}
+
+void libabw::ABWEventLog::_record(ABWEventType type, const char *arg0, const char *arg1,
+                                  const char *arg2, const char *arg3, const char *arg4,
+                                  const char *arg5, const char *arg6, const char *arg7,
+                                  const char *arg8)
+{
+  if (!m_isComplete)
+    return;
+
+  const char *const args[] = { arg0, arg1, arg2, arg3, arg4, arg5, arg6, arg7, arg8 };
+  unsigned long lengths[ABW_NUM_ELEMENTS(args)];
+  unsigned long eventSize = 1;
+  for (unsigned i = 0; i < EVENT_ARG_COUNTS[type]; ++i)
+  {
+    // 0 is a missing argument, otherwise the length of the string + 1
+    lengths[i] = args[i] ? strlen(args[i]) + 1 : 0;
+    eventSize += lengths[i] + 1;
+  }
+  if (m_buffer.size() + eventSize > m_maxSize)
+  {
+    ABW_DEBUG_MSG(("libabw::ABWEventLog::_record: the log is too big, stop recording after %lu events\n", m_eventCount));
+    m_isComplete = false;
+    std::vector<char>().swap(m_buffer);
+    return;
+  }
+
+  m_buffer.push_back(char(type));
+  for (unsigned i = 0; i < EVENT_ARG_COUNTS[type]; ++i)
+  {
+    appendLength(m_buffer, lengths[i]);
+    if (lengths[i])
+      m_buffer.insert(m_buffer.end(), args[i], args[i] + lengths[i]);
+  }
+  ++m_eventCount;
+  m_size = (unsigned long)m_buffer.size();
+}
+
+void libabw::ABWEventLog::collectTextStyle(const char *name, const char *basedon, const char *followedby, const char *props)
+{
+  _record(ABW_EVENT_COLLECT_TEXT_STYLE, name, basedon, followedby, props);
+  m_collector->collectTextStyle(name, basedon, followedby, props);
+}
+
+void libabw::ABWEventLog::collectDocumentProperties(const char *props)
+{
+  _record(ABW_EVENT_COLLECT_DOCUMENT_PROPERTIES, props);
+  m_collector->collectDocumentProperties(props);
+}
+
+void libabw::ABWEventLog::collectParagraphProperties(const char *level, const char *listid, const char *parentid, const char *style, const char *props)
+{
+  _record(ABW_EVENT_COLLECT_PARAGRAPH_PROPERTIES, level, listid, parentid, style, props);
+  m_collector->collectParagraphProperties(level, listid, parentid, style, props);
+}
+
+void libabw::ABWEventLog::collectSectionProperties(const char *footer, const char *footerLeft, const char *footerFirst, const char *footerLast, const char *header, const char *headerLeft, const char *headerFirst, const char *headerLast, const char *props)
+{
+  _record(ABW_EVENT_COLLECT_SECTION_PROPERTIES, footer, footerLeft, footerFirst, footerLast, header, headerLeft, headerFirst, headerLast, props);
+  m_collector->collectSectionProperties(footer, footerLeft, footerFirst, footerLast, header, headerLeft, headerFirst, headerLast, props);
+}
+
+void libabw::ABWEventLog::collectCharacterProperties(const char *style, const char *props)
+{
+  _record(ABW_EVENT_COLLECT_CHARACTER_PROPERTIES, style, props);
+  m_collector->collectCharacterProperties(style, props);
+}
+
+void libabw::ABWEventLog::collectPageSize(const char *width, const char *height, const char *units, const char *pageScale)
+{
+  _record(ABW_EVENT_COLLECT_PAGE_SIZE, width, height, units, pageScale);
+  m_collector->collectPageSize(width, height, units, pageScale);
+}
+
+void libabw::ABWEventLog::closeParagraphOrListElement()
+{
+  _record(ABW_EVENT_CLOSE_PARAGRAPH_OR_LIST_ELEMENT);
+  m_collector->closeParagraphOrListElement();
+}
+
+void libabw::ABWEventLog::closeSpan()
+{
+  _record(ABW_EVENT_CLOSE_SPAN);
+  m_collector->closeSpan();
+}
+
+void libabw::ABWEventLog::openLink(const char *href)
+{
+  _record(ABW_EVENT_OPEN_LINK, href);
+  m_collector->openLink(href);
+}
+
+void libabw::ABWEventLog::closeLink()
+{
+  _record(ABW_EVENT_CLOSE_LINK);
+  m_collector->closeLink();
+}
+
+void libabw::ABWEventLog::openFoot(const char *id)
+{
+  _record(ABW_EVENT_OPEN_FOOT, id);
+  m_collector->openFoot(id);
+}
+
+void libabw::ABWEventLog::closeFoot()
+{
+  _record(ABW_EVENT_CLOSE_FOOT);
+  m_collector->closeFoot();
+}
+
+void libabw::ABWEventLog::openEndnote(const char *id)
+{
+  _record(ABW_EVENT_OPEN_ENDNOTE, id);
+  m_collector->openEndnote(id);
+}
+
+void libabw::ABWEventLog::closeEndnote()
+{
+  _record(ABW_EVENT_CLOSE_ENDNOTE);
+  m_collector->closeEndnote();
+}
+
+void libabw::ABWEventLog::openField(const char *type, const char *id)
+{
+  _record(ABW_EVENT_OPEN_FIELD, type, id);
+  m_collector->openField(type, id);
+}
+
+void libabw::ABWEventLog::closeField()
+{
+  _record(ABW_EVENT_CLOSE_FIELD);
+  m_collector->closeField();
+}
+
+void libabw::ABWEventLog::endSection()
+{
+  _record(ABW_EVENT_END_SECTION);
+  m_collector->endSection();
+}
+
+void libabw::ABWEventLog::startDocument()
+{
+  _record(ABW_EVENT_START_DOCUMENT);
+  m_collector->startDocument();
+}
+
+void libabw::ABWEventLog::endDocument()
+{
+  _record(ABW_EVENT_END_DOCUMENT);
+  m_collector->endDocument();
+}
+
+void libabw::ABWEventLog::insertLineBreak()
+{
+  _record(ABW_EVENT_INSERT_LINE_BREAK);
+  m_collector->insertLineBreak();
+}
+
+void libabw::ABWEventLog::insertColumnBreak()
+{
+  _record(ABW_EVENT_INSERT_COLUMN_BREAK);
+  m_collector->insertColumnBreak();
+}
+
+void libabw::ABWEventLog::insertPageBreak()
+{
+  _record(ABW_EVENT_INSERT_PAGE_BREAK);
+  m_collector->insertPageBreak();
+}
+
+void libabw::ABWEventLog::insertText(const char *text)
+{
+  _record(ABW_EVENT_INSERT_TEXT, text);
+  m_collector->insertText(text);
+}
+
+void libabw::ABWEventLog::insertImage(const char *dataid, const char *props)
+{
+  _record(ABW_EVENT_INSERT_IMAGE, dataid, props);
+  m_collector->insertImage(dataid, props);
+}
+
+void libabw::ABWEventLog::collectList(const char *id, const char *listDecimal, const char *listDelim, const char *parentid, const char *startValue, const char *type)
+{
+  _record(ABW_EVENT_COLLECT_LIST, id, listDecimal, listDelim, parentid, startValue, type);
+  m_collector->collectList(id, listDecimal, listDelim, parentid, startValue, type);
+}
+
+void libabw::ABWEventLog::collectData(const char *name, const char *mimeType, const librevenge::RVNGBinaryData &data)
+{
+  m_collector->collectData(name, mimeType, data);
+}
+
+bool libabw::ABWEventLog::isDataCollected() const
+{
+  return m_collector->isDataCollected();
+}
+
+void libabw::ABWEventLog::collectHeaderFooter(const char *id, const char *type)
+{
+  _record(ABW_EVENT_COLLECT_HEADER_FOOTER, id, type);
+  m_collector->collectHeaderFooter(id, type);
+}
+
+void libabw::ABWEventLog::openTable(const char *props)
+{
+  _record(ABW_EVENT_OPEN_TABLE, props);
+  m_collector->openTable(props);
+}
+
+void libabw::ABWEventLog::closeTable()
+{
+  _record(ABW_EVENT_CLOSE_TABLE);
+  m_collector->closeTable();
+}
+
+void libabw::ABWEventLog::openCell(const char *props)
+{
+  _record(ABW_EVENT_OPEN_CELL, props);
+  m_collector->openCell(props);
+}
+
+void libabw::ABWEventLog::closeCell()
+{
+  _record(ABW_EVENT_CLOSE_CELL);
+  m_collector->closeCell();
+}
+
+void libabw::ABWEventLog::openFrame(const char *props, const char *imageId, const char *title, const char *alt)
+{
+  _record(ABW_EVENT_OPEN_FRAME, props, imageId, title, alt);
+  m_collector->openFrame(props, imageId, title, alt);
+}
+
+void libabw::ABWEventLog::closeFrame(ABWOutputElements *(&elements), bool &pageFrame)
+{
+  _record(ABW_EVENT_CLOSE_FRAME);
+  m_collector->closeFrame(elements, pageFrame);
+}
+
+void libabw::ABWEventLog::addFrameElements(ABWOutputElements &elements, bool pageFrame)
+{
+  m_collector->addFrameElements(elements, pageFrame);
+}
+
+void libabw::ABWEventLog::addMetadataEntry(const char *name, const char *value)
+{
+  _record(ABW_EVENT_ADD_METADATA_ENTRY, name, value);
+  m_collector->addMetadataEntry(name, value);
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
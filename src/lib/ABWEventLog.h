@@ -0,0 +1,167 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libabw project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef __ABWEVENTLOG_H__
+#define __ABWEVENTLOG_H__
+
+#include <memory>
+#include <vector>
+#include <librevenge/librevenge.h>
+#include "ABWCollector.h"
+
+namespace libabw
+{
+
+enum ABWEventType
+{
+  ABW_EVENT_COLLECT_TEXT_STYLE = 0,
+  ABW_EVENT_COLLECT_DOCUMENT_PROPERTIES,
+  ABW_EVENT_COLLECT_PARAGRAPH_PROPERTIES,
+  ABW_EVENT_COLLECT_SECTION_PROPERTIES,
+  ABW_EVENT_COLLECT_CHARACTER_PROPERTIES,
+  ABW_EVENT_COLLECT_PAGE_SIZE,
+  ABW_EVENT_CLOSE_PARAGRAPH_OR_LIST_ELEMENT,
+  ABW_EVENT_CLOSE_SPAN,
+  ABW_EVENT_OPEN_LINK,
+  ABW_EVENT_CLOSE_LINK,
+  ABW_EVENT_OPEN_FOOT,
+  ABW_EVENT_CLOSE_FOOT,
+  ABW_EVENT_OPEN_ENDNOTE,
+  ABW_EVENT_CLOSE_ENDNOTE,
+  ABW_EVENT_OPEN_FIELD,
+  ABW_EVENT_CLOSE_FIELD,
+  ABW_EVENT_END_SECTION,
+  ABW_EVENT_START_DOCUMENT,
+  ABW_EVENT_END_DOCUMENT,
+  ABW_EVENT_INSERT_LINE_BREAK,
+  ABW_EVENT_INSERT_COLUMN_BREAK,
+  ABW_EVENT_INSERT_PAGE_BREAK,
+  ABW_EVENT_INSERT_TEXT,
+  ABW_EVENT_INSERT_IMAGE,
+  ABW_EVENT_COLLECT_LIST,
+  ABW_EVENT_COLLECT_HEADER_FOOTER,
+  ABW_EVENT_OPEN_TABLE,
+  ABW_EVENT_CLOSE_TABLE,
+  ABW_EVENT_OPEN_CELL,
+  ABW_EVENT_CLOSE_CELL,
+  ABW_EVENT_OPEN_FRAME,
+  ABW_EVENT_CLOSE_FRAME,
+  ABW_EVENT_ADD_METADATA_ENTRY
+};
+
+/// One event read back from an ABWEventLog; the strings point into the log
+struct ABWLoggedEvent
+{
+  ABWLoggedEvent();
+
+  /// Sends the event to a collector
+  void dispatch(ABWCollector &collector) const;
+
+  ABWEventType m_type;
+  const char *m_args[9];
+};
+
+/** Collector recording the events it gets, so that the content can be
+    collected without parsing the document again.
+
+    Every event is forwarded to the collector given in the constructor.
+    The events are stored in one buffer: the type, then each string
+    argument as its length and its characters. The data are not recorded,
+    they are only needed by the styles collector. If the buffer would grow
+    over maxSize bytes, the recording stops and the log is incomplete; the
+    recorded events are dropped, but still counted by eventCount and size.
+  */
+class ABWEventLog : public ABWCollector
+{
+public:
+  ABWEventLog(ABWCollector *collector, unsigned long maxSize);
+  ~ABWEventLog() override;
+
+  /// Whether all the events were recorded
+  bool isComplete() const
+  {
+    return m_isComplete;
+  }
+  /// Size of the recorded events in bytes
+  unsigned long size() const
+  {
+    return m_size;
+  }
+  /// Number of the recorded events
+  unsigned long eventCount() const
+  {
+    return m_eventCount;
+  }
+  /// Reads the event at pos and moves pos after it, returns false at the end of the log
+  bool readEvent(unsigned long &pos, ABWLoggedEvent &event) const;
+
+  // collector functions
+
+  void collectTextStyle(const char *name, const char *basedon, const char *followedby, const char *props) override;
+  void collectDocumentProperties(const char *props) override;
+  void collectParagraphProperties(const char *level, const char *listid, const char *parentid, const char *style, const char *props) override;
+  void collectSectionProperties(const char *footer, const char *footerLeft, const char *footerFirst, const char *footerLast, const char *header, const char *headerLeft, const char *headerFirst, const char *headerLast, const char *props) override;
+  void collectCharacterProperties(const char *style, const char *props) override;
+  void collectPageSize(const char *width, const char *height, const char *units, const char *pageScale) override;
+  void closeParagraphOrListElement() override;
+  void closeSpan() override;
+  void openLink(const char *href) override;
+  void closeLink() override;
+  void openFoot(const char *id) override;
+  void closeFoot() override;
+  void openEndnote(const char *id) override;
+  void closeEndnote() override;
+  void openField(const char *type, const char *id) override;
+  void closeField() override;
+  void endSection() override;
+  void startDocument() override;
+  void endDocument() override;
+  void insertLineBreak() override;
+  void insertColumnBreak() override;
+  void insertPageBreak() override;
+  void insertText(const char *text) override;
+  void insertImage(const char *dataid, const char *props) override;
+  void collectList(const char *id, const char *listDecimal, const char *listDelim, const char *parentid, const char *startValue, const char *type) override;
+
+  void collectData(const char *name, const char *mimeType, const librevenge::RVNGBinaryData &data) override;
+  bool isDataCollected() const override;
+  void collectHeaderFooter(const char *id, const char *type) override;
+
+  void openTable(const char *props) override;
+  void closeTable() override;
+  void openCell(const char *props) override;
+  void closeCell() override;
+
+  void openFrame(const char *props, const char *imageId, const char *title, const char *alt) override;
+  void closeFrame(ABWOutputElements *(&elements), bool &pageFrame) override;
+  void addFrameElements(ABWOutputElements &elements, bool pageFrame) override;
+
+  void addMetadataEntry(const char *name, const char *value) override;
+
+private:
+  ABWEventLog(const ABWEventLog &);
+  ABWEventLog &operator=(const ABWEventLog &);
+
+  void _record(ABWEventType type, const char *arg0 = nullptr, const char *arg1 = nullptr,
+               const char *arg2 = nullptr, const char *arg3 = nullptr, const char *arg4 = nullptr,
+               const char *arg5 = nullptr, const char *arg6 = nullptr, const char *arg7 = nullptr,
+               const char *arg8 = nullptr);
+
+  std::unique_ptr<ABWCollector> m_collector;
+  unsigned long m_maxSize;
+  bool m_isComplete;
+  unsigned long m_eventCount;
+  unsigned long m_size;
+  std::vector<char> m_buffer;
+};
+
+} // namespace libabw
+
+#endif /* __ABWEVENTLOG_H__ */
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,161 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libabw project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <algorithm>
+#include "ABWMappedFileStream.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "libabw_internal.h"
+
+namespace libabw
+{
+
+ABWMappedFileStream::ABWMappedFileStream(const char *path) :
+  librevenge::RVNGInputStream(),
+  m_isOpen(false),
+  m_data(nullptr),
+  m_size(0),
+  m_offset(0)
+#ifdef _WIN32
+  , m_mapping(nullptr)
+#endif
+{
+  if (!path)
+    return;
+
+#ifdef _WIN32
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return;
+  LARGE_INTEGER size;
+  if (GetFileSizeEx(file, &size) && size.HighPart == 0 && size.LowPart < 0x80000000)
+  {
+    m_size = size.LowPart;
+    if (m_size == 0)
+      m_isOpen = true;
+    else
+    {
+      m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+      if (m_mapping)
+      {
+        m_data = static_cast<const unsigned char *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        if (m_data)
+          m_isOpen = true;
+        else
+        {
+          CloseHandle(m_mapping);
+          m_mapping = nullptr;
+        }
+      }
+    }
+  }
+  CloseHandle(file);
+#else
+  const int fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return;
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size < 0x80000000L)
+  {
+    m_size = (unsigned long) st.st_size;
+    if (m_size == 0)
+      m_isOpen = true;
+    else
+    {
+      void *const data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data != MAP_FAILED)
+      {
+        (void) posix_madvise(data, m_size, POSIX_MADV_SEQUENTIAL);
+        m_data = static_cast<const unsigned char *>(data);
+        m_isOpen = true;
+      }
+    }
+  }
+  close(fd);
+#endif
+
+  if (!m_isOpen)
+  {
+    ABW_DEBUG_MSG(("ABWMappedFileStream: could not map %s\n", path));
+    m_size = 0;
+  }
+}
+
+ABWMappedFileStream::~ABWMappedFileStream()
+{
+  if (!m_data)
+    return;
+#ifdef _WIN32
+  UnmapViewOfFile(m_data);
+  CloseHandle(m_mapping);
+#else
+  munmap(const_cast<unsigned char *>(m_data), m_size);
+#endif
+}
+
+const unsigned char *ABWMappedFileStream::read(unsigned long numBytes, unsigned long &numBytesRead)
+{
+  numBytesRead = 0;
+
+  if (numBytes == 0 || (unsigned long)m_offset >= m_size)
+    return nullptr;
+
+  numBytesRead = std::min(numBytes, m_size - (unsigned long)m_offset);
+  const unsigned char *const data = m_data + m_offset;
+  m_offset += numBytesRead;
+
+  return data;
+}
+
+int ABWMappedFileStream::seek(long offset, librevenge::RVNG_SEEK_TYPE seekType)
+{
+  if (seekType == librevenge::RVNG_SEEK_CUR)
+    m_offset += offset;
+  else if (seekType == librevenge::RVNG_SEEK_SET)
+    m_offset = offset;
+  else if (seekType == librevenge::RVNG_SEEK_END)
+    m_offset = (long) m_size + offset;
+
+  if (m_offset < 0)
+  {
+    m_offset = 0;
+    return 1;
+  }
+  if ((unsigned long)m_offset > m_size)
+  {
+    m_offset = (long) m_size;
+    return 1;
+  }
+
+  return 0;
+}
+
+long ABWMappedFileStream::tell()
+{
+  return m_offset;
+}
+
+bool ABWMappedFileStream::isEnd()
+{
+  return (unsigned long)m_offset >= m_size;
+}
+
+} // namespace libabw
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,77 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libabw project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef __ABWMAPPEDFILESTREAM_H__
+#define __ABWMAPPEDFILESTREAM_H__
+
+#include <librevenge-stream/librevenge-stream.h>
+
+namespace libabw
+{
+
+/** Input stream reading a file mapped into memory.
+
+    Every read returns a pointer into the mapping, which stays valid
+    as long as the stream exists.
+  */
+class ABWMappedFileStream : public librevenge::RVNGInputStream
+{
+public:
+  explicit ABWMappedFileStream(const char *path);
+  ~ABWMappedFileStream() override;
+
+  bool isOpen() const
+  {
+    return m_isOpen;
+  }
+
+  bool isStructured() override
+  {
+    return false;
+  }
+  unsigned subStreamCount() override
+  {
+    return 0;
+  }
+  const char *subStreamName(unsigned) override
+  {
+    return nullptr;
+  }
+  bool existsSubStream(const char *) override
+  {
+    return false;
+  }
+  librevenge::RVNGInputStream *getSubStreamByName(const char *) override
+  {
+    return nullptr;
+  }
+  librevenge::RVNGInputStream *getSubStreamById(unsigned) override
+  {
+    return nullptr;
+  }
+  const unsigned char *read(unsigned long numBytes, unsigned long &numBytesRead) override;
+  int seek(long offset, librevenge::RVNG_SEEK_TYPE seekType) override;
+  long tell() override;
+  bool isEnd() override;
+private:
+  bool m_isOpen;
+  const unsigned char *m_data;
+  unsigned long m_size;
+  long m_offset;
+#ifdef _WIN32
+  void *m_mapping;
+#endif
+  ABWMappedFileStream(const ABWMappedFileStream &);
+  ABWMappedFileStream &operator=(const ABWMappedFileStream &);
+};
+
+} // namespace libabw
+
+#endif // __ABWMAPPEDFILESTREAM_H__
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
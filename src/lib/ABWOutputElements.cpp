@@ -7,398 +7,118 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/.
  */
 
-#include "ABWOutputElements.h"
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <vector>
 
-namespace
-{
-
-typedef libabw::ABWOutputElements::OutputElements_t OutputElements_t;
-typedef libabw::ABWOutputElements::OutputElementsMap_t OutputElementsMap_t;
-
-template<typename T, typename... Args>
-std::unique_ptr<T> make_unique(Args &&... args)
-{
-  return std::unique_ptr<T>(new T(std::forward<Args>(args)...));
-}
+#include "ABWOutputElements.h"
+#include "libabw_internal.h"
 
-}
+#define ABW_MIN_OUTPUT_CHUNK_SIZE 16
+#define ABW_MAX_OUTPUT_CHUNK_SIZE 1024
+#define ABW_MAX_PROPLIST_POOL_SIZE 1024 // distinct property lists kept for reuse
+#define ABW_MAX_SPARE_OUTPUT_CHUNKS 8 // emptied chunks kept for reuse by clear()
 
 namespace libabw
 {
 
-class ABWOutputElement
-{
-public:
-  ABWOutputElement() {}
-  virtual ~ABWOutputElement() {}
-  virtual void write(librevenge::RVNGTextInterface *iface,
-                     const OutputElementsMap_t *footers,
-                     const OutputElementsMap_t *headers) const = 0;
-};
-
-class ABWCloseEndnoteElement : public ABWOutputElement
-{
-public:
-  ABWCloseEndnoteElement() {}
-  ~ABWCloseEndnoteElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-};
-
-class ABWCloseFooterElement : public ABWOutputElement
-{
-public:
-  ABWCloseFooterElement() {}
-  ~ABWCloseFooterElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-};
-
-class ABWCloseFootnoteElement : public ABWOutputElement
-{
-public:
-  ABWCloseFootnoteElement() {}
-  ~ABWCloseFootnoteElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-};
-
-class ABWCloseFrameElement : public ABWOutputElement
-{
-public:
-  ABWCloseFrameElement() {}
-  ~ABWCloseFrameElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-};
-
-class ABWCloseHeaderElement : public ABWOutputElement
-{
-public:
-  ABWCloseHeaderElement() {}
-  ~ABWCloseHeaderElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-};
-
-class ABWCloseLinkElement : public ABWOutputElement
-{
-public:
-  ABWCloseLinkElement() {}
-  ~ABWCloseLinkElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-};
-
-class ABWCloseListElementElement : public ABWOutputElement
-{
-public:
-  ABWCloseListElementElement() {}
-  ~ABWCloseListElementElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
+enum ABWOutputEventType
+{
+  ABW_OUTPUT_CLOSE_ENDNOTE = 0,
+  ABW_OUTPUT_CLOSE_FOOTER,
+  ABW_OUTPUT_CLOSE_FOOTNOTE,
+  ABW_OUTPUT_CLOSE_FRAME,
+  ABW_OUTPUT_CLOSE_HEADER,
+  ABW_OUTPUT_CLOSE_LINK,
+  ABW_OUTPUT_CLOSE_LIST_ELEMENT,
+  ABW_OUTPUT_CLOSE_ORDERED_LIST_LEVEL,
+  ABW_OUTPUT_CLOSE_PAGE_SPAN,
+  ABW_OUTPUT_CLOSE_PARAGRAPH,
+  ABW_OUTPUT_CLOSE_SECTION,
+  ABW_OUTPUT_CLOSE_SPAN,
+  ABW_OUTPUT_CLOSE_TABLE,
+  ABW_OUTPUT_CLOSE_TABLE_CELL,
+  ABW_OUTPUT_CLOSE_TABLE_ROW,
+  ABW_OUTPUT_CLOSE_TEXT_BOX,
+  ABW_OUTPUT_CLOSE_UNORDERED_LIST_LEVEL,
+  ABW_OUTPUT_INSERT_BINARY_OBJECT,
+  ABW_OUTPUT_INSERT_COVERED_TABLE_CELL,
+  ABW_OUTPUT_INSERT_FIELD,
+  ABW_OUTPUT_INSERT_IMAGE,
+  ABW_OUTPUT_INSERT_IMAGE_DATA,
+  ABW_OUTPUT_INSERT_LINE_BREAK,
+  ABW_OUTPUT_INSERT_SPACE,
+  ABW_OUTPUT_INSERT_TAB,
+  ABW_OUTPUT_INSERT_TEXT,
+  ABW_OUTPUT_OPEN_ENDNOTE,
+  ABW_OUTPUT_OPEN_FOOTER,
+  ABW_OUTPUT_OPEN_FOOTNOTE,
+  ABW_OUTPUT_OPEN_FRAME,
+  ABW_OUTPUT_OPEN_HEADER,
+  ABW_OUTPUT_OPEN_LINK,
+  ABW_OUTPUT_OPEN_LIST_ELEMENT,
+  ABW_OUTPUT_OPEN_LIST_LEVEL,
+  ABW_OUTPUT_OPEN_ORDERED_LIST_LEVEL,
+  ABW_OUTPUT_OPEN_PAGE_SPAN,
+  ABW_OUTPUT_OPEN_PARAGRAPH,
+  ABW_OUTPUT_OPEN_SECTION,
+  ABW_OUTPUT_OPEN_SPAN,
+  ABW_OUTPUT_OPEN_TABLE,
+  ABW_OUTPUT_OPEN_TABLE_CELL,
+  ABW_OUTPUT_OPEN_TABLE_ROW,
+  ABW_OUTPUT_OPEN_TEXT_BOX,
+  ABW_OUTPUT_OPEN_UNORDERED_LIST_LEVEL,
+  ABW_OUTPUT_SET_DOCUMENT_META_DATA,
+  ABW_OUTPUT_START_DOCUMENT
 };
 
-class ABWCloseOrderedListLevelElement : public ABWOutputElement
+/// One recorded output event; its arguments are stored in the chunk containing it
+struct ABWOutputEvent
 {
-public:
-  ABWCloseOrderedListLevelElement() {}
-  ~ABWCloseOrderedListLevelElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-};
-
-class ABWClosePageSpanElement : public ABWOutputElement
-{
-public:
-  ABWClosePageSpanElement() {}
-  ~ABWClosePageSpanElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-};
-
-class ABWCloseParagraphElement : public ABWOutputElement
-{
-public:
-  ABWCloseParagraphElement() {}
-  ~ABWCloseParagraphElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-};
-
-class ABWCloseSectionElement : public ABWOutputElement
-{
-public:
-  ABWCloseSectionElement() {}
-  ~ABWCloseSectionElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-};
-
-class ABWCloseSpanElement : public ABWOutputElement
-{
-public:
-  ABWCloseSpanElement() {}
-  ~ABWCloseSpanElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-};
-
-class ABWCloseTableElement : public ABWOutputElement
-{
-public:
-  ABWCloseTableElement() {}
-  ~ABWCloseTableElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-};
-
-class ABWCloseTableCellElement : public ABWOutputElement
-{
-public:
-  ABWCloseTableCellElement() {}
-  ~ABWCloseTableCellElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-};
-
-class ABWCloseTableRowElement : public ABWOutputElement
-{
-public:
-  ABWCloseTableRowElement() {}
-  ~ABWCloseTableRowElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-};
-
-class ABWCloseTextBoxElement : public ABWOutputElement
-{
-public:
-  ABWCloseTextBoxElement() {}
-  ~ABWCloseTextBoxElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-};
-
-class ABWCloseUnorderedListLevelElement : public ABWOutputElement
-{
-public:
-  ABWCloseUnorderedListLevelElement() {}
-  ~ABWCloseUnorderedListLevelElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-};
-
-class ABWInsertBinaryObjectElement : public ABWOutputElement
-{
-public:
-  ABWInsertBinaryObjectElement(const librevenge::RVNGPropertyList &propList) :
-    m_propList(propList) {}
-  ~ABWInsertBinaryObjectElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-private:
-  librevenge::RVNGPropertyList m_propList;
-};
-
-class ABWInsertFieldElement : public ABWOutputElement
-{
-public:
-  ABWInsertFieldElement(const librevenge::RVNGPropertyList &propList) :
-    m_propList(propList) {}
-  ~ABWInsertFieldElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-private:
-  librevenge::RVNGPropertyList m_propList;
-};
+  ABWOutputEvent(ABWOutputEventType type, unsigned propList, unsigned extra) :
+    m_type(type), m_propList(propList), m_extra(extra) {}
 
-class ABWInsertCoveredTableCellElement : public ABWOutputElement
-{
-public:
-  ABWInsertCoveredTableCellElement(const librevenge::RVNGPropertyList &propList) :
-    m_propList(propList) {}
-  ~ABWInsertCoveredTableCellElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-private:
-  librevenge::RVNGPropertyList m_propList;
+  ABWOutputEventType m_type;
+  /** index of the property list of the event in ABWOutputChunk::m_propLists,
+      or in ABWOutputChunk::m_sharedPropLists for spans, paragraphs and list elements
+    */
+  unsigned m_propList;
+  /// index of the other arguments of the event, in the vector of its type
+  unsigned m_extra;
 };
 
-class ABWInsertLineBreakElement : public ABWOutputElement
+struct ABWOutputImage
 {
-public:
-  ABWInsertLineBreakElement() {}
-  ~ABWInsertLineBreakElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-};
+  ABWOutputImage(const std::string &dataId, ABWDataMap &data) :
+    m_dataId(dataId), m_data(&data) {}
+  // the data map is shared by the copies
+  ABWOutputImage(const ABWOutputImage &image) :
+    m_dataId(image.m_dataId), m_data(image.m_data) {}
+  ABWOutputImage &operator=(const ABWOutputImage &image)
+  {
+    m_dataId = image.m_dataId;
+    m_data = image.m_data;
+    return *this;
+  }
 
-class ABWInsertSpaceElement : public ABWOutputElement
-{
-public:
-  ABWInsertSpaceElement() {}
-  ~ABWInsertSpaceElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
+  std::string m_dataId;
+  ABWDataMap *m_data;
 };
 
-class ABWInsertTabElement : public ABWOutputElement
+struct ABWOutputListLevel
 {
-public:
-  ABWInsertTabElement() {}
-  ~ABWInsertTabElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-};
-
-class ABWInsertTextElement : public ABWOutputElement
-{
-public:
-  ABWInsertTextElement(const librevenge::RVNGString &text) :
-    m_text(text) {}
-  ~ABWInsertTextElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-private:
-  librevenge::RVNGString m_text;
-};
-
-class ABWOpenEndnoteElement : public ABWOutputElement
-{
-public:
-  ABWOpenEndnoteElement(const librevenge::RVNGPropertyList &propList) :
-    m_propList(propList) {}
-  ~ABWOpenEndnoteElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-private:
-  librevenge::RVNGPropertyList m_propList;
-};
-
-class ABWOpenFooterElement : public ABWOutputElement
-{
-public:
-  ABWOpenFooterElement(const librevenge::RVNGPropertyList &propList) :
-    m_propList(propList) {}
-  ~ABWOpenFooterElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-private:
-  librevenge::RVNGPropertyList m_propList;
-};
-
-class ABWOpenFootnoteElement : public ABWOutputElement
-{
-public:
-  ABWOpenFootnoteElement(const librevenge::RVNGPropertyList &propList) :
-    m_propList(propList) {}
-  ~ABWOpenFootnoteElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-private:
-  librevenge::RVNGPropertyList m_propList;
-};
-
-class ABWOpenFrameElement : public ABWOutputElement
-{
-public:
-  ABWOpenFrameElement(const librevenge::RVNGPropertyList &propList) :
-    m_propList(propList) {}
-  ~ABWOpenFrameElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-private:
-  librevenge::RVNGPropertyList m_propList;
-};
-
-class ABWOpenHeaderElement : public ABWOutputElement
-{
-public:
-  ABWOpenHeaderElement(const librevenge::RVNGPropertyList &propList) :
-    m_propList(propList) {}
-  ~ABWOpenHeaderElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-private:
-  librevenge::RVNGPropertyList m_propList;
-};
-
-class ABWOpenLinkElement : public ABWOutputElement
-{
-public:
-  ABWOpenLinkElement(const librevenge::RVNGPropertyList &propList) :
-    m_propList(propList) {}
-  ~ABWOpenLinkElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-private:
-  librevenge::RVNGPropertyList m_propList;
-};
-
-class ABWOpenListElementElement : public ABWOutputElement
-{
-public:
-  ABWOpenListElementElement(const librevenge::RVNGPropertyList &propList) :
-    m_propList(propList) {}
-  ~ABWOpenListElementElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-private:
-  librevenge::RVNGPropertyList m_propList;
-};
+  ABWOutputListLevel(const std::shared_ptr<const ABWListElement> &listElement, int listId) :
+    m_listElement(listElement), m_listId(listId) {}
 
-class ABWOpenOrderedListLevelElement : public ABWOutputElement
-{
-public:
-  ABWOpenOrderedListLevelElement(const librevenge::RVNGPropertyList &propList) :
-    m_propList(propList) {}
-  ~ABWOpenOrderedListLevelElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-private:
-  librevenge::RVNGPropertyList m_propList;
+  std::shared_ptr<const ABWListElement> m_listElement;
+  int m_listId;
 };
 
-class ABWOpenPageSpanElement : public ABWOutputElement
+struct ABWOutputPageSpan
 {
-public:
-  ABWOpenPageSpanElement(const librevenge::RVNGPropertyList &propList,
-                         int footer, int footerLeft, int footerFirst, int footerLast,
-                         int header, int headerLeft, int headerFirst, int headerLast) :
-    m_propList(propList),
+  ABWOutputPageSpan(int footer, int footerLeft, int footerFirst, int footerLast,
+                    int header, int headerLeft, int headerFirst, int headerLast) :
     m_footer(footer),
     m_footerLeft(footerLeft),
     m_footerFirst(footerFirst),
@@ -407,14 +127,7 @@ public:
     m_headerLeft(headerLeft),
     m_headerFirst(headerFirst),
     m_headerLast(headerLast) {}
-  ~ABWOpenPageSpanElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-private:
-  void _writeElements(librevenge::RVNGTextInterface *iface, int id,
-                      const OutputElementsMap_t *elements) const;
-  librevenge::RVNGPropertyList m_propList;
+
   int m_footer;
   int m_footerLeft;
   int m_footerFirst;
@@ -425,643 +138,949 @@ private:
   int m_headerLast;
 };
 
-class ABWOpenParagraphElement : public ABWOutputElement
-{
-public:
-  ABWOpenParagraphElement(const librevenge::RVNGPropertyList &propList) :
-    m_propList(propList) {}
-  ~ABWOpenParagraphElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-private:
-  librevenge::RVNGPropertyList m_propList;
-};
+struct ABWOutputTable
+{
+  ABWOutputTable(const librevenge::RVNGPropertyListVector &columns, int tableId, const std::map<int, int> &tableSizes) :
+    m_columns(columns), m_tableId(tableId), m_tableSizes(&tableSizes) {}
+  // the table sizes are shared by the copies
+  ABWOutputTable(const ABWOutputTable &table) :
+    m_columns(table.m_columns), m_tableId(table.m_tableId), m_tableSizes(table.m_tableSizes) {}
+  ABWOutputTable &operator=(const ABWOutputTable &table)
+  {
+    m_columns = table.m_columns;
+    m_tableId = table.m_tableId;
+    m_tableSizes = table.m_tableSizes;
+    return *this;
+  }
 
-class ABWOpenSectionElement : public ABWOutputElement
-{
-public:
-  ABWOpenSectionElement(const librevenge::RVNGPropertyList &propList) :
-    m_propList(propList) {}
-  ~ABWOpenSectionElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-private:
-  librevenge::RVNGPropertyList m_propList;
+  librevenge::RVNGPropertyListVector m_columns;
+  int m_tableId;
+  const std::map<int, int> *m_tableSizes;
 };
 
-class ABWOpenSpanElement : public ABWOutputElement
-{
-public:
-  ABWOpenSpanElement(const librevenge::RVNGPropertyList &propList) :
-    m_propList(propList) {}
-  ~ABWOpenSpanElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-private:
-  librevenge::RVNGPropertyList m_propList;
-};
+/** A block of consecutive output events, with their arguments.
 
-class ABWOpenTableElement : public ABWOutputElement
-{
-public:
-  ABWOpenTableElement(const librevenge::RVNGPropertyList &propList) :
-    m_propList(propList) {}
-  ~ABWOpenTableElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-private:
-  librevenge::RVNGPropertyList m_propList;
-};
+    The events and the arguments used by most of them are reserved for
+    the capacity of the chunk, so they are never moved while it fills up.
+  */
+struct ABWOutputChunk
+{
+  explicit ABWOutputChunk(unsigned capacity);
 
-class ABWOpenTableCellElement : public ABWOutputElement
-{
-public:
-  ABWOpenTableCellElement(const librevenge::RVNGPropertyList &propList) :
-    m_propList(propList) {}
-  ~ABWOpenTableCellElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-private:
-  librevenge::RVNGPropertyList m_propList;
+  bool isFull() const
+  {
+    return m_spillOffset >= 0 || m_events.size() >= m_capacity;
+  }
+  void add(ABWOutputEventType type, unsigned extra = 0);
+  void add(ABWOutputEventType type, const librevenge::RVNGPropertyList &propList, unsigned extra = 0);
+  void add(ABWOutputEventType type, const ABWPropertyListPool::Handle &propList);
+  //! whether the events of chunk fit in the room left in this one
+  bool canAppend(const ABWOutputChunk &chunk) const
+  {
+    return m_spillOffset < 0 && chunk.m_spillOffset < 0 && m_events.size() + chunk.m_events.size() <= m_capacity;
+  }
+  //! moves the events of chunk and their arguments to the end of this one, leaving chunk empty
+  void append(ABWOutputChunk &chunk);
+  //! frees the records and the texts, once they are in the spill file
+  void release();
+  //! drops the events, keeping the storage reserved for the capacity
+  void clear();
+
+  unsigned m_capacity;
+  //! where the records and the texts are in the spill file, or -1
+  long m_spillOffset;
+  std::vector<ABWOutputEvent> m_events;
+  std::vector<librevenge::RVNGPropertyList> m_propLists;
+  std::vector<ABWPropertyListPool::Handle> m_sharedPropLists;
+  std::vector<librevenge::RVNGString> m_texts;
+  std::vector<ABWOutputImage> m_images;
+  std::vector<ABWOutputListLevel> m_listLevels;
+  std::vector<ABWOutputPageSpan> m_pageSpans;
+  std::vector<ABWOutputTable> m_tables;
 };
 
-class ABWOpenTableRowElement : public ABWOutputElement
-{
-public:
-  ABWOpenTableRowElement(const librevenge::RVNGPropertyList &propList) :
-    m_propList(propList) {}
-  ~ABWOpenTableRowElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-private:
-  librevenge::RVNGPropertyList m_propList;
-};
+} // namespace libabw
 
-class ABWOpenTextBoxElement : public ABWOutputElement
-{
-public:
-  ABWOpenTextBoxElement(const librevenge::RVNGPropertyList &propList) :
-    m_propList(propList) {}
-  ~ABWOpenTextBoxElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-private:
-  librevenge::RVNGPropertyList m_propList;
-};
+namespace
+{
 
-class ABWOpenUnorderedListLevelElement : public ABWOutputElement
-{
-public:
-  ABWOpenUnorderedListLevelElement(const librevenge::RVNGPropertyList &propList) :
-    m_propList(propList) {}
-  ~ABWOpenUnorderedListLevelElement() override {}
-  void write(librevenge::RVNGTextInterface *iface,
-             const OutputElementsMap_t *footers,
-             const OutputElementsMap_t *headers) const override;
-private:
-  librevenge::RVNGPropertyList m_propList;
-};
+using libabw::ABWOutputChunk;
+using libabw::ABWOutputEvent;
 
-} // namespace libabw
+typedef libabw::ABWOutputElements::OutputElements_t OutputElements_t;
+typedef libabw::ABWOutputElements::OutputElementsMap_t OutputElementsMap_t;
 
-void libabw::ABWCloseEndnoteElement::write(librevenge::RVNGTextInterface *iface,
-                                           const OutputElementsMap_t *,
-                                           const OutputElementsMap_t *) const
-{
-  if (iface)
-    iface->closeEndnote();
-}
+void writeEvents(librevenge::RVNGTextInterface *iface, const OutputElements_t &elements,
+                 const OutputElementsMap_t *footers, const OutputElementsMap_t *headers,
+                 unsigned long firstEvent = 0);
 
-void libabw::ABWCloseFooterElement::write(librevenge::RVNGTextInterface *iface,
-                                          const OutputElementsMap_t *,
-                                          const OutputElementsMap_t *) const
+void writeHeaderFooter(librevenge::RVNGTextInterface *iface, int id, const OutputElementsMap_t *elements)
 {
-  if (iface)
-    iface->closeFooter();
-}
+  if (!elements || id < 0)
+    return;
 
-void libabw::ABWCloseFootnoteElement::write(librevenge::RVNGTextInterface *iface,
-                                            const OutputElementsMap_t *,
-                                            const OutputElementsMap_t *) const
-{
-  if (iface)
-    iface->closeFootnote();
+  auto iterMap = elements->find(id);
+  if (iterMap == elements->end() || iterMap->second.empty())
+    return;
+
+  writeEvents(iface, iterMap->second, nullptr, nullptr);
 }
 
-void libabw::ABWCloseFrameElement::write(librevenge::RVNGTextInterface *iface,
-                                         const OutputElementsMap_t *,
-                                         const OutputElementsMap_t *) const
+void writeImageData(librevenge::RVNGTextInterface *iface, const libabw::ABWOutputImage &image,
+                    const librevenge::RVNGPropertyList *frameProps)
 {
-  if (iface)
+  const libabw::ABWData *data = image.m_data->acquire(image.m_dataId);
+  if (!data)
+  {
+    if (!frameProps)
+    {
+      ABW_DEBUG_MSG(("libabw::ABWOutputElements::write: can not find the image\n"));
+    }
+    return;
+  }
+  if (frameProps)
+    iface->openFrame(*frameProps);
+  librevenge::RVNGPropertyList propList;
+  propList.insert("librevenge:mime-type", data->m_mimeType);
+  propList.insert("office:binary-data", data->m_binaryData);
+  iface->insertBinaryObject(propList);
+  if (frameProps)
     iface->closeFrame();
+  image.m_data->release(image.m_dataId);
 }
 
-void libabw::ABWCloseHeaderElement::write(librevenge::RVNGTextInterface *iface,
-                                          const OutputElementsMap_t *,
-                                          const OutputElementsMap_t *) const
+void writeListLevel(librevenge::RVNGTextInterface *iface, const libabw::ABWOutputListLevel &listLevel)
 {
-  if (iface)
-    iface->closeHeader();
+  if (!listLevel.m_listElement)
+    return;
+  librevenge::RVNGPropertyList propList;
+  listLevel.m_listElement->writeOut(propList);
+  // osnola: use the element list id if set, if not use the id the level was opened with
+  propList.insert("librevenge:list-id", listLevel.m_listElement->m_listId ? listLevel.m_listElement->m_listId : listLevel.m_listId);
+  if (listLevel.m_listElement->getType() == libabw::ABW_UNORDERED)
+    iface->openUnorderedListLevel(propList);
+  else
+    iface->openOrderedListLevel(propList);
+}
+
+void writePageSpan(librevenge::RVNGTextInterface *iface, const librevenge::RVNGPropertyList &propList,
+                   const libabw::ABWOutputPageSpan &pageSpan,
+                   const OutputElementsMap_t *footers, const OutputElementsMap_t *headers)
+{
+  // open the page span
+  iface->openPageSpan(propList);
+  // write out the footers
+  writeHeaderFooter(iface, pageSpan.m_footer, footers);
+  writeHeaderFooter(iface, pageSpan.m_footerLeft, footers);
+  writeHeaderFooter(iface, pageSpan.m_footerFirst, footers);
+  writeHeaderFooter(iface, pageSpan.m_footerLast, footers);
+  // write out the headers
+  writeHeaderFooter(iface, pageSpan.m_header, headers);
+  writeHeaderFooter(iface, pageSpan.m_headerLeft, headers);
+  writeHeaderFooter(iface, pageSpan.m_headerFirst, headers);
+  writeHeaderFooter(iface, pageSpan.m_headerLast, headers);
+  // and continue with writing out the other stuff
+}
+
+void writeTable(librevenge::RVNGTextInterface *iface, const librevenge::RVNGPropertyList &tableProps,
+                const libabw::ABWOutputTable &table)
+{
+  // the number of columns is only known once the whole table was seen
+  auto numColumns = unsigned(table.m_columns.count());
+  auto iter = table.m_tableSizes->find(table.m_tableId);
+  if (iter != table.m_tableSizes->end())
+    numColumns = unsigned(iter->second);
+  librevenge::RVNGPropertyListVector columns;
+  for (unsigned j = 0; j < numColumns; ++j)
+  {
+    if (j < table.m_columns.count())
+      columns.append(table.m_columns[j]);
+    else
+      columns.append(librevenge::RVNGPropertyList());
+  }
+  librevenge::RVNGPropertyList propList(tableProps);
+  if (columns.count())
+    propList.insert("librevenge:table-columns", columns);
+  iface->openTable(propList);
 }
 
-void libabw::ABWCloseLinkElement::write(librevenge::RVNGTextInterface *iface,
-                                        const OutputElementsMap_t *,
-                                        const OutputElementsMap_t *) const
+void writeEvent(librevenge::RVNGTextInterface *iface, const ABWOutputChunk &chunk, const ABWOutputEvent &event,
+                const OutputElementsMap_t *footers, const OutputElementsMap_t *headers)
 {
-  if (iface)
+  switch (event.m_type)
+  {
+  case libabw::ABW_OUTPUT_CLOSE_ENDNOTE:
+    iface->closeEndnote();
+    break;
+  case libabw::ABW_OUTPUT_CLOSE_FOOTER:
+    iface->closeFooter();
+    break;
+  case libabw::ABW_OUTPUT_CLOSE_FOOTNOTE:
+    iface->closeFootnote();
+    break;
+  case libabw::ABW_OUTPUT_CLOSE_FRAME:
+    iface->closeFrame();
+    break;
+  case libabw::ABW_OUTPUT_CLOSE_HEADER:
+    iface->closeHeader();
+    break;
+  case libabw::ABW_OUTPUT_CLOSE_LINK:
     iface->closeLink();
-}
-
-void libabw::ABWCloseListElementElement::write(librevenge::RVNGTextInterface *iface,
-                                               const OutputElementsMap_t *,
-                                               const OutputElementsMap_t *) const
-{
-  if (iface)
+    break;
+  case libabw::ABW_OUTPUT_CLOSE_LIST_ELEMENT:
     iface->closeListElement();
-}
-
-void libabw::ABWCloseOrderedListLevelElement::write(librevenge::RVNGTextInterface *iface,
-                                                    const OutputElementsMap_t *,
-                                                    const OutputElementsMap_t *) const
-{
-  if (iface)
+    break;
+  case libabw::ABW_OUTPUT_CLOSE_ORDERED_LIST_LEVEL:
     iface->closeOrderedListLevel();
-}
-
-void libabw::ABWClosePageSpanElement::write(librevenge::RVNGTextInterface *iface,
-                                            const OutputElementsMap_t *,
-                                            const OutputElementsMap_t *) const
-{
-  if (iface)
+    break;
+  case libabw::ABW_OUTPUT_CLOSE_PAGE_SPAN:
     iface->closePageSpan();
-}
-
-void libabw::ABWCloseParagraphElement::write(librevenge::RVNGTextInterface *iface,
-                                             const OutputElementsMap_t *,
-                                             const OutputElementsMap_t *) const
-{
-  if (iface)
+    break;
+  case libabw::ABW_OUTPUT_CLOSE_PARAGRAPH:
     iface->closeParagraph();
-}
-
-void libabw::ABWCloseSectionElement::write(librevenge::RVNGTextInterface *iface,
-                                           const OutputElementsMap_t *,
-                                           const OutputElementsMap_t *) const
-{
-  if (iface)
+    break;
+  case libabw::ABW_OUTPUT_CLOSE_SECTION:
     iface->closeSection();
-}
-
-void libabw::ABWCloseSpanElement::write(librevenge::RVNGTextInterface *iface,
-                                        const OutputElementsMap_t *,
-                                        const OutputElementsMap_t *) const
-{
-  if (iface)
+    break;
+  case libabw::ABW_OUTPUT_CLOSE_SPAN:
     iface->closeSpan();
-}
-
-void libabw::ABWCloseTableElement::write(librevenge::RVNGTextInterface *iface,
-                                         const OutputElementsMap_t *,
-                                         const OutputElementsMap_t *) const
-{
-  if (iface)
+    break;
+  case libabw::ABW_OUTPUT_CLOSE_TABLE:
     iface->closeTable();
-}
-
-void libabw::ABWCloseTableCellElement::write(librevenge::RVNGTextInterface *iface,
-                                             const OutputElementsMap_t *,
-                                             const OutputElementsMap_t *) const
-{
-  if (iface)
+    break;
+  case libabw::ABW_OUTPUT_CLOSE_TABLE_CELL:
     iface->closeTableCell();
-}
-
-void libabw::ABWCloseTableRowElement::write(librevenge::RVNGTextInterface *iface,
-                                            const OutputElementsMap_t *,
-                                            const OutputElementsMap_t *) const
-{
-  if (iface)
+    break;
+  case libabw::ABW_OUTPUT_CLOSE_TABLE_ROW:
     iface->closeTableRow();
-}
-
-void libabw::ABWCloseTextBoxElement::write(librevenge::RVNGTextInterface *iface,
-                                           const OutputElementsMap_t *,
-                                           const OutputElementsMap_t *) const
-{
-  if (iface)
+    break;
+  case libabw::ABW_OUTPUT_CLOSE_TEXT_BOX:
     iface->closeTextBox();
-}
-
-void libabw::ABWCloseUnorderedListLevelElement::write(librevenge::RVNGTextInterface *iface,
-                                                      const OutputElementsMap_t *,
-                                                      const OutputElementsMap_t *) const
-{
-  if (iface)
+    break;
+  case libabw::ABW_OUTPUT_CLOSE_UNORDERED_LIST_LEVEL:
     iface->closeUnorderedListLevel();
+    break;
+  case libabw::ABW_OUTPUT_INSERT_BINARY_OBJECT:
+    iface->insertBinaryObject(chunk.m_propLists[event.m_propList]);
+    break;
+  case libabw::ABW_OUTPUT_INSERT_COVERED_TABLE_CELL:
+    iface->insertCoveredTableCell(chunk.m_propLists[event.m_propList]);
+    break;
+  case libabw::ABW_OUTPUT_INSERT_FIELD:
+    iface->insertField(chunk.m_propLists[event.m_propList]);
+    break;
+  case libabw::ABW_OUTPUT_INSERT_IMAGE:
+    writeImageData(iface, chunk.m_images[event.m_extra], &chunk.m_propLists[event.m_propList]);
+    break;
+  case libabw::ABW_OUTPUT_INSERT_IMAGE_DATA:
+    writeImageData(iface, chunk.m_images[event.m_extra], nullptr);
+    break;
+  case libabw::ABW_OUTPUT_INSERT_LINE_BREAK:
+    iface->insertLineBreak();
+    break;
+  case libabw::ABW_OUTPUT_INSERT_SPACE:
+    iface->insertSpace();
+    break;
+  case libabw::ABW_OUTPUT_INSERT_TAB:
+    iface->insertTab();
+    break;
+  case libabw::ABW_OUTPUT_INSERT_TEXT:
+    iface->insertText(chunk.m_texts[event.m_extra]);
+    break;
+  case libabw::ABW_OUTPUT_OPEN_ENDNOTE:
+    iface->openEndnote(chunk.m_propLists[event.m_propList]);
+    break;
+  case libabw::ABW_OUTPUT_OPEN_FOOTER:
+    iface->openFooter(chunk.m_propLists[event.m_propList]);
+    break;
+  case libabw::ABW_OUTPUT_OPEN_FOOTNOTE:
+    iface->openFootnote(chunk.m_propLists[event.m_propList]);
+    break;
+  case libabw::ABW_OUTPUT_OPEN_FRAME:
+    iface->openFrame(chunk.m_propLists[event.m_propList]);
+    break;
+  case libabw::ABW_OUTPUT_OPEN_HEADER:
+    iface->openHeader(chunk.m_propLists[event.m_propList]);
+    break;
+  case libabw::ABW_OUTPUT_OPEN_LINK:
+    iface->openLink(chunk.m_propLists[event.m_propList]);
+    break;
+  case libabw::ABW_OUTPUT_OPEN_LIST_ELEMENT:
+    iface->openListElement(*chunk.m_sharedPropLists[event.m_propList]);
+    break;
+  case libabw::ABW_OUTPUT_OPEN_LIST_LEVEL:
+    writeListLevel(iface, chunk.m_listLevels[event.m_extra]);
+    break;
+  case libabw::ABW_OUTPUT_OPEN_ORDERED_LIST_LEVEL:
+    iface->openOrderedListLevel(chunk.m_propLists[event.m_propList]);
+    break;
+  case libabw::ABW_OUTPUT_OPEN_PAGE_SPAN:
+    writePageSpan(iface, chunk.m_propLists[event.m_propList], chunk.m_pageSpans[event.m_extra], footers, headers);
+    break;
+  case libabw::ABW_OUTPUT_OPEN_PARAGRAPH:
+    iface->openParagraph(*chunk.m_sharedPropLists[event.m_propList]);
+    break;
+  case libabw::ABW_OUTPUT_OPEN_SECTION:
+    iface->openSection(chunk.m_propLists[event.m_propList]);
+    break;
+  case libabw::ABW_OUTPUT_OPEN_SPAN:
+    iface->openSpan(*chunk.m_sharedPropLists[event.m_propList]);
+    break;
+  case libabw::ABW_OUTPUT_OPEN_TABLE:
+    writeTable(iface, chunk.m_propLists[event.m_propList], chunk.m_tables[event.m_extra]);
+    break;
+  case libabw::ABW_OUTPUT_OPEN_TABLE_CELL:
+    iface->openTableCell(chunk.m_propLists[event.m_propList]);
+    break;
+  case libabw::ABW_OUTPUT_OPEN_TABLE_ROW:
+    iface->openTableRow(chunk.m_propLists[event.m_propList]);
+    break;
+  case libabw::ABW_OUTPUT_OPEN_TEXT_BOX:
+    iface->openTextBox(chunk.m_propLists[event.m_propList]);
+    break;
+  case libabw::ABW_OUTPUT_OPEN_UNORDERED_LIST_LEVEL:
+    iface->openUnorderedListLevel(chunk.m_propLists[event.m_propList]);
+    break;
+  case libabw::ABW_OUTPUT_SET_DOCUMENT_META_DATA:
+    iface->setDocumentMetaData(chunk.m_propLists[event.m_propList]);
+    break;
+  case libabw::ABW_OUTPUT_START_DOCUMENT:
+    iface->startDocument(chunk.m_propLists[event.m_propList]);
+    break;
+  default:
+    break;
+  }
 }
 
-void libabw::ABWInsertBinaryObjectElement::write(librevenge::RVNGTextInterface *iface,
-                                                 const OutputElementsMap_t *,
-                                                 const OutputElementsMap_t *) const
-{
-  if (iface)
-    iface->insertBinaryObject(m_propList);
-}
-
-void libabw::ABWInsertFieldElement::write(librevenge::RVNGTextInterface *iface,
-                                          const OutputElementsMap_t *,
-                                          const OutputElementsMap_t *) const
-{
-  if (iface)
-    iface->insertField(m_propList);
-}
-
-void libabw::ABWInsertCoveredTableCellElement::write(librevenge::RVNGTextInterface *iface,
-                                                     const OutputElementsMap_t *,
-                                                     const OutputElementsMap_t *) const
+void writeEvents(librevenge::RVNGTextInterface *iface, const OutputElements_t &elements,
+                 const OutputElementsMap_t *footers, const OutputElementsMap_t *headers,
+                 unsigned long firstEvent)
 {
-  if (iface)
-    iface->insertCoveredTableCell(m_propList);
+  for (const auto &chunk : elements)
+  {
+    for (auto i = firstEvent; i < chunk->m_events.size(); ++i)
+      writeEvent(iface, *chunk, chunk->m_events[i], footers, headers);
+    firstEvent = 0;
+  }
 }
 
-void libabw::ABWInsertLineBreakElement::write(librevenge::RVNGTextInterface *iface,
-                                              const OutputElementsMap_t *,
-                                              const OutputElementsMap_t *) const
-{
-  if (iface)
-    iface->insertLineBreak();
-}
+} // anonymous namespace
 
-void libabw::ABWInsertSpaceElement::write(librevenge::RVNGTextInterface *iface,
-                                          const OutputElementsMap_t *,
-                                          const OutputElementsMap_t *) const
+libabw::ABWOutputChunk::ABWOutputChunk(const unsigned capacity) :
+  m_capacity(capacity),
+  m_spillOffset(-1),
+  m_events(),
+  m_propLists(),
+  m_sharedPropLists(),
+  m_texts(),
+  m_images(),
+  m_listLevels(),
+  m_pageSpans(),
+  m_tables()
 {
-  if (iface)
-    iface->insertSpace();
+  m_events.reserve(capacity);
+  m_sharedPropLists.reserve(capacity);
+  m_texts.reserve(capacity);
 }
 
-void libabw::ABWInsertTabElement::write(librevenge::RVNGTextInterface *iface,
-                                        const OutputElementsMap_t *,
-                                        const OutputElementsMap_t *) const
+void libabw::ABWOutputChunk::add(const ABWOutputEventType type, const unsigned extra)
 {
-  if (iface)
-    iface->insertTab();
+  m_events.push_back(ABWOutputEvent(type, 0, extra));
 }
 
-void libabw::ABWInsertTextElement::write(librevenge::RVNGTextInterface *iface,
-                                         const OutputElementsMap_t *,
-                                         const OutputElementsMap_t *) const
+void libabw::ABWOutputChunk::add(const ABWOutputEventType type, const librevenge::RVNGPropertyList &propList, const unsigned extra)
 {
-  if (iface)
-    iface->insertText(m_text);
+  m_propLists.push_back(propList);
+  m_events.push_back(ABWOutputEvent(type, unsigned(m_propLists.size() - 1), extra));
 }
 
-void libabw::ABWOpenEndnoteElement::write(librevenge::RVNGTextInterface *iface,
-                                          const OutputElementsMap_t *,
-                                          const OutputElementsMap_t *) const
+void libabw::ABWOutputChunk::add(const ABWOutputEventType type, const ABWPropertyListPool::Handle &propList)
 {
-  if (iface)
-    iface->openEndnote(m_propList);
+  m_sharedPropLists.push_back(propList);
+  m_events.push_back(ABWOutputEvent(type, unsigned(m_sharedPropLists.size() - 1), 0));
 }
 
-void libabw::ABWOpenFooterElement::write(librevenge::RVNGTextInterface *iface,
-                                         const OutputElementsMap_t *,
-                                         const OutputElementsMap_t *) const
+void libabw::ABWOutputChunk::release()
 {
-  if (iface)
-    iface->openFooter(m_propList);
+  std::vector<ABWOutputEvent>().swap(m_events);
+  std::vector<librevenge::RVNGString>().swap(m_texts);
 }
 
-void libabw::ABWOpenFootnoteElement::write(librevenge::RVNGTextInterface *iface,
-                                           const OutputElementsMap_t *,
-                                           const OutputElementsMap_t *) const
+void libabw::ABWOutputChunk::append(ABWOutputChunk &chunk)
 {
-  if (iface)
-    iface->openFootnote(m_propList);
+  const auto propListOffset = unsigned(m_propLists.size());
+  const auto sharedPropListOffset = unsigned(m_sharedPropLists.size());
+  const auto textOffset = unsigned(m_texts.size());
+  const auto imageOffset = unsigned(m_images.size());
+  const auto listLevelOffset = unsigned(m_listLevels.size());
+  const auto pageSpanOffset = unsigned(m_pageSpans.size());
+  const auto tableOffset = unsigned(m_tables.size());
+  for (ABWOutputEvent event : chunk.m_events)
+  {
+    switch (event.m_type)
+    {
+    case ABW_OUTPUT_OPEN_LIST_ELEMENT:
+    case ABW_OUTPUT_OPEN_PARAGRAPH:
+    case ABW_OUTPUT_OPEN_SPAN:
+      event.m_propList += sharedPropListOffset;
+      break;
+    case ABW_OUTPUT_INSERT_IMAGE:
+      event.m_propList += propListOffset;
+      event.m_extra += imageOffset;
+      break;
+    case ABW_OUTPUT_INSERT_IMAGE_DATA:
+      event.m_extra += imageOffset;
+      break;
+    case ABW_OUTPUT_INSERT_TEXT:
+      event.m_extra += textOffset;
+      break;
+    case ABW_OUTPUT_OPEN_LIST_LEVEL:
+      event.m_extra += listLevelOffset;
+      break;
+    case ABW_OUTPUT_OPEN_PAGE_SPAN:
+      event.m_propList += propListOffset;
+      event.m_extra += pageSpanOffset;
+      break;
+    case ABW_OUTPUT_OPEN_TABLE:
+      event.m_propList += propListOffset;
+      event.m_extra += tableOffset;
+      break;
+    default:
+      event.m_propList += propListOffset;
+      break;
+    }
+    m_events.push_back(event);
+  }
+  std::move(chunk.m_propLists.begin(), chunk.m_propLists.end(), std::back_inserter(m_propLists));
+  std::move(chunk.m_sharedPropLists.begin(), chunk.m_sharedPropLists.end(), std::back_inserter(m_sharedPropLists));
+  std::move(chunk.m_texts.begin(), chunk.m_texts.end(), std::back_inserter(m_texts));
+  std::move(chunk.m_images.begin(), chunk.m_images.end(), std::back_inserter(m_images));
+  std::move(chunk.m_listLevels.begin(), chunk.m_listLevels.end(), std::back_inserter(m_listLevels));
+  std::move(chunk.m_pageSpans.begin(), chunk.m_pageSpans.end(), std::back_inserter(m_pageSpans));
+  std::move(chunk.m_tables.begin(), chunk.m_tables.end(), std::back_inserter(m_tables));
+  chunk.clear();
 }
 
-void libabw::ABWOpenFrameElement::write(librevenge::RVNGTextInterface *iface,
-                                        const OutputElementsMap_t *,
-                                        const OutputElementsMap_t *) const
+void libabw::ABWOutputChunk::clear()
 {
-  if (iface)
-    iface->openFrame(m_propList);
+  m_spillOffset = -1;
+  m_events.clear();
+  m_propLists.clear();
+  m_sharedPropLists.clear();
+  m_texts.clear();
+  m_images.clear();
+  m_listLevels.clear();
+  m_pageSpans.clear();
+  m_tables.clear();
+  // release() frees them
+  m_events.reserve(m_capacity);
+  m_texts.reserve(m_capacity);
 }
 
-void libabw::ABWOpenHeaderElement::write(librevenge::RVNGTextInterface *iface,
-                                         const OutputElementsMap_t *,
-                                         const OutputElementsMap_t *) const
-{
-  if (iface)
-    iface->openHeader(m_propList);
-}
+// ABWPropertyListPool
 
-void libabw::ABWOpenListElementElement::write(librevenge::RVNGTextInterface *iface,
-                                              const OutputElementsMap_t *,
-                                              const OutputElementsMap_t *) const
+libabw::ABWPropertyListPool::ABWPropertyListPool()
+  : m_entries(), m_stats()
 {
-  if (iface)
-    iface->openListElement(m_propList);
 }
 
-void libabw::ABWOpenLinkElement::write(librevenge::RVNGTextInterface *iface,
-                                       const OutputElementsMap_t *,
-                                       const OutputElementsMap_t *) const
+libabw::ABWPropertyListPool::Handle libabw::ABWPropertyListPool::find(const std::string &key)
 {
-  if (iface)
-    iface->openLink(m_propList);
+  auto iter = m_entries.find(key);
+  if (iter == m_entries.end())
+    return Handle();
+  ++m_stats.m_uses;
+  m_stats.m_savedBytes += iter->second.m_size;
+  return iter->second.m_propList;
 }
 
-void libabw::ABWOpenOrderedListLevelElement::write(librevenge::RVNGTextInterface *iface,
-                                                   const OutputElementsMap_t *,
-                                                   const OutputElementsMap_t *) const
+libabw::ABWPropertyListPool::Handle libabw::ABWPropertyListPool::insert(const std::string &key,
+                                                                       const librevenge::RVNGPropertyList &propList)
 {
-  if (iface)
-    iface->openOrderedListLevel(m_propList);
+  // forget the lists, not the handles, if the document has too many distinct ones
+  if (m_entries.size() >= ABW_MAX_PROPLIST_POOL_SIZE)
+    m_entries.clear();
+  Entry &entry = m_entries[key];
+  entry.m_propList = std::make_shared<const librevenge::RVNGPropertyList>(propList);
+  entry.m_size = sizeof(librevenge::RVNGPropertyList) + propList.getPropString().size();
+  ++m_stats.m_lists;
+  ++m_stats.m_uses;
+  return entry.m_propList;
 }
 
-void libabw::ABWOpenPageSpanElement::write(librevenge::RVNGTextInterface *iface,
-                                           const OutputElementsMap_t *footers,
-                                           const OutputElementsMap_t *headers) const
+const libabw::ABWPropertyListPool::Stats &libabw::ABWPropertyListPool::getStats() const
 {
-  if (iface)
-  {
-    // open the page span
-    iface->openPageSpan(m_propList);
-    // write out the footers
-    _writeElements(iface, m_footer, footers);
-    _writeElements(iface, m_footerLeft, footers);
-    _writeElements(iface, m_footerFirst, footers);
-    _writeElements(iface, m_footerLast, footers);
-    // write out the headers
-    _writeElements(iface, m_header, headers);
-    _writeElements(iface, m_headerLeft, headers);
-    _writeElements(iface, m_headerFirst, headers);
-    _writeElements(iface, m_headerLast, headers);
-    // and continue with writing out the other stuff
-  }
-
+  return m_stats;
 }
 
-void libabw::ABWOpenPageSpanElement::_writeElements(librevenge::RVNGTextInterface *iface, int id,
-                                                    const OutputElementsMap_t *elements) const
-{
-  if (!elements || id < 0 || !iface)
-    return;
-
-  auto iterMap = elements->find(id);
-  if (iterMap == elements->end() || iterMap->second.empty())
-    return;
-
-  for (const auto &iterVec : iterMap->second)
-    iterVec->write(iface, nullptr, nullptr);
-}
+// ABWOutputElements
 
-void libabw::ABWOpenParagraphElement::write(librevenge::RVNGTextInterface *iface,
-                                            const OutputElementsMap_t *,
-                                            const OutputElementsMap_t *) const
+libabw::ABWOutputElements::ABWOutputElements()
+  : m_bodyElements(), m_headerElements(), m_footerElements(), m_elements(nullptr), m_flushedEvents(0)
+  , m_spillThreshold(0), m_bufferedSize(0), m_spillFile(nullptr)
+  , m_isMergingEvents(false), m_openSpans(), m_closedSpan(), m_spareChunks()
 {
-  if (iface)
-    iface->openParagraph(m_propList);
+  m_elements = &m_bodyElements;
 }
 
-void libabw::ABWOpenSectionElement::write(librevenge::RVNGTextInterface *iface,
-                                          const OutputElementsMap_t *,
-                                          const OutputElementsMap_t *) const
+libabw::ABWOutputElements::~ABWOutputElements()
 {
-  if (iface)
-    iface->openSection(m_propList);
+  if (m_spillFile)
+    std::fclose(m_spillFile);
 }
 
-void libabw::ABWOpenSpanElement::write(librevenge::RVNGTextInterface *iface,
-                                       const OutputElementsMap_t *,
-                                       const OutputElementsMap_t *) const
+void libabw::ABWOutputElements::splice(ABWOutputElements &elements)
 {
-  if (iface)
-    iface->openSpan(m_propList);
+  // most frames fit in the last chunk, and keep theirs to be reused
+  if (elements.m_bodyElements.size() == 1 && !m_bodyElements.empty()
+      && m_bodyElements.back()->canAppend(*elements.m_bodyElements.front()))
+    m_bodyElements.back()->append(*elements.m_bodyElements.front());
+  else
+    m_bodyElements.splice(m_bodyElements.end(), elements.m_bodyElements);
+  m_bufferedSize += elements.m_bufferedSize;
+  elements.m_bufferedSize = 0;
+  m_closedSpan.reset();
+}
+
+void libabw::ABWOutputElements::clear()
+{
+  _keepSpareChunk(m_bodyElements);
+  for (auto &headerElements : m_headerElements)
+    _keepSpareChunk(headerElements.second);
+  for (auto &footerElements : m_footerElements)
+    _keepSpareChunk(footerElements.second);
+  m_bodyElements.clear();
+  m_headerElements.clear();
+  m_footerElements.clear();
+  m_elements = &m_bodyElements;
+  m_flushedEvents = 0;
+  m_bufferedSize = 0;
+  if (m_spillFile)
+    std::fclose(m_spillFile);
+  m_spillFile = nullptr;
+  m_openSpans.clear();
+  m_closedSpan.reset();
 }
 
-void libabw::ABWOpenTableElement::write(librevenge::RVNGTextInterface *iface,
-                                        const OutputElementsMap_t *,
-                                        const OutputElementsMap_t *) const
+bool libabw::ABWOutputElements::write(librevenge::RVNGTextInterface *iface)
 {
-  if (iface)
-    iface->openTable(m_propList);
+  if (!iface)
+    return true;
+  unsigned long firstEvent = m_flushedEvents;
+  for (const auto &chunk : m_bodyElements)
+  {
+    const bool isSpilled = chunk->m_spillOffset >= 0;
+    if (isSpilled && !_readChunk(*chunk))
+    {
+      ABW_DEBUG_MSG(("libabw::ABWOutputElements::write: can not read back a chunk from the spill file\n"));
+      return false;
+    }
+    for (auto i = firstEvent; i < chunk->m_events.size(); ++i)
+      writeEvent(iface, *chunk, chunk->m_events[i], &m_footerElements, &m_headerElements);
+    if (isSpilled)
+      chunk->release();
+    firstEvent = 0;
+  }
+  return true;
 }
 
-void libabw::ABWOpenTableCellElement::write(librevenge::RVNGTextInterface *iface,
-                                            const OutputElementsMap_t *,
-                                            const OutputElementsMap_t *) const
+void libabw::ABWOutputElements::setSpillThreshold(const unsigned long threshold)
 {
-  if (iface)
-    iface->openTableCell(m_propList);
+  m_spillThreshold = threshold;
 }
 
-void libabw::ABWOpenTableRowElement::write(librevenge::RVNGTextInterface *iface,
-                                           const OutputElementsMap_t *,
-                                           const OutputElementsMap_t *) const
+void libabw::ABWOutputElements::setMergingEvents(const bool merge)
 {
-  if (iface)
-    iface->openTableRow(m_propList);
+  m_isMergingEvents = merge;
 }
 
-void libabw::ABWOpenTextBoxElement::write(librevenge::RVNGTextInterface *iface,
-                                          const OutputElementsMap_t *,
-                                          const OutputElementsMap_t *) const
+bool libabw::ABWOutputElements::flush(librevenge::RVNGTextInterface *iface)
 {
-  if (iface)
-    iface->openTextBox(m_propList);
+  if (!iface)
+    return true;
+  while (!m_bodyElements.empty())
+  {
+    ABWOutputChunk &chunk = *m_bodyElements.front();
+    if (chunk.m_spillOffset >= 0)
+    {
+      // it stays in memory from now, as it might only be written partially
+      if (!_readChunk(chunk))
+      {
+        ABW_DEBUG_MSG(("libabw::ABWOutputElements::flush: can not read back a chunk from the spill file\n"));
+        return false;
+      }
+      chunk.m_spillOffset = -1;
+    }
+    for (; m_flushedEvents < chunk.m_events.size(); ++m_flushedEvents)
+    {
+      const ABWOutputEvent &event = chunk.m_events[m_flushedEvents];
+      if (event.m_type == ABW_OUTPUT_OPEN_PAGE_SPAN)
+      {
+        // the headers and the footers are written with the page span
+        const ABWOutputPageSpan &pageSpan = chunk.m_pageSpans[event.m_extra];
+        if (!_isComplete(pageSpan.m_footer, m_footerElements) || !_isComplete(pageSpan.m_footerLeft, m_footerElements) ||
+            !_isComplete(pageSpan.m_footerFirst, m_footerElements) || !_isComplete(pageSpan.m_footerLast, m_footerElements) ||
+            !_isComplete(pageSpan.m_header, m_headerElements) || !_isComplete(pageSpan.m_headerLeft, m_headerElements) ||
+            !_isComplete(pageSpan.m_headerFirst, m_headerElements) || !_isComplete(pageSpan.m_headerLast, m_headerElements))
+          return true;
+      }
+      writeEvent(iface, chunk, event, &m_footerElements, &m_headerElements);
+    }
+    // keep the last chunk, the next events are added to it
+    if (m_bodyElements.size() == 1)
+      return true;
+    m_bodyElements.pop_front();
+    m_flushedEvents = 0;
+  }
+  return true;
 }
 
-void libabw::ABWOpenUnorderedListLevelElement::write(librevenge::RVNGTextInterface *iface,
-                                                     const OutputElementsMap_t *,
-                                                     const OutputElementsMap_t *) const
+void libabw::ABWOutputElements::_spillChunks()
 {
-  if (iface)
-    iface->openUnorderedListLevel(m_propList);
+  if (!m_spillFile)
+  {
+    m_spillFile = std::tmpfile();
+    if (!m_spillFile)
+    {
+      ABW_DEBUG_MSG(("libabw::ABWOutputElements::_spillChunks: can not create a temporary file, keeping the output in memory\n"));
+      m_spillThreshold = 0;
+      return;
+    }
+  }
+  if (std::fseek(m_spillFile, 0, SEEK_END))
+    return;
+  for (const auto &chunk : m_bodyElements)
+  {
+    // the first chunk might be written partially already
+    if (chunk->m_spillOffset >= 0 || (m_flushedEvents && chunk == m_bodyElements.front()))
+      continue;
+    const long offset = std::ftell(m_spillFile);
+    const auto eventCount = (unsigned long) chunk->m_events.size();
+    const auto textCount = (unsigned long) chunk->m_texts.size();
+    bool ok = offset >= 0 && std::fwrite(&eventCount, sizeof(eventCount), 1, m_spillFile) == 1
+              && std::fwrite(chunk->m_events.data(), sizeof(ABWOutputEvent), eventCount, m_spillFile) == eventCount
+              && std::fwrite(&textCount, sizeof(textCount), 1, m_spillFile) == 1;
+    for (auto iter = chunk->m_texts.begin(); ok && iter != chunk->m_texts.end(); ++iter)
+    {
+      const unsigned long length = iter->size();
+      ok = std::fwrite(&length, sizeof(length), 1, m_spillFile) == 1
+           && std::fwrite(iter->cstr(), 1, length, m_spillFile) == length;
+    }
+    if (!ok)
+    {
+      ABW_DEBUG_MSG(("libabw::ABWOutputElements::_spillChunks: can not write to the spill file, keeping the output in memory\n"));
+      m_spillThreshold = 0;
+      return;
+    }
+    chunk->m_spillOffset = offset;
+    chunk->release();
+  }
+  m_bufferedSize = 0;
+}
+
+bool libabw::ABWOutputElements::_readChunk(ABWOutputChunk &chunk)
+{
+  if (!m_spillFile || std::fseek(m_spillFile, chunk.m_spillOffset, SEEK_SET))
+    return false;
+  unsigned long eventCount = 0;
+  if (std::fread(&eventCount, sizeof(eventCount), 1, m_spillFile) != 1 || eventCount > chunk.m_capacity)
+    return false;
+  chunk.m_events.resize(eventCount, ABWOutputEvent(ABW_OUTPUT_CLOSE_SPAN, 0, 0));
+  unsigned long textCount = 0;
+  if (std::fread(chunk.m_events.data(), sizeof(ABWOutputEvent), eventCount, m_spillFile) != eventCount
+      || std::fread(&textCount, sizeof(textCount), 1, m_spillFile) != 1 || textCount > eventCount)
+    return false;
+  chunk.m_texts.reserve(textCount);
+  std::string text;
+  for (unsigned long i = 0; i < textCount; ++i)
+  {
+    unsigned long length = 0;
+    if (std::fread(&length, sizeof(length), 1, m_spillFile) != 1)
+      return false;
+    text.resize(length);
+    if (length && std::fread(&text[0], 1, length, m_spillFile) != length)
+      return false;
+    chunk.m_texts.push_back(librevenge::RVNGString(text.c_str()));
+  }
+  return true;
 }
 
-// ABWOutputElements
-
-libabw::ABWOutputElements::ABWOutputElements()
-  : m_bodyElements(), m_headerElements(), m_footerElements(), m_elements(nullptr)
+bool libabw::ABWOutputElements::_isComplete(const int id, const OutputElementsMap_t &elements) const
 {
-  m_elements = &m_bodyElements;
+  if (id < 0)
+    return true;
+  auto iter = elements.find(id);
+  return iter != elements.end() && m_elements != &iter->second;
 }
 
-libabw::ABWOutputElements::~ABWOutputElements()
+libabw::ABWOutputChunk *libabw::ABWOutputElements::_getLastEventChunk(const int type) const
 {
+  if (!m_elements || m_elements->empty())
+    return nullptr;
+  ABWOutputChunk *const chunk = m_elements->back().get();
+  if (chunk->m_events.empty() || chunk->m_events.back().m_type != type)
+    return nullptr;
+  // the events flushed already can not be changed
+  if (m_elements == &m_bodyElements && m_bodyElements.size() == 1 && m_flushedEvents >= chunk->m_events.size())
+    return nullptr;
+  return chunk;
 }
 
-void libabw::ABWOutputElements::splice(ABWOutputElements &elements)
+libabw::ABWOutputChunk *libabw::ABWOutputElements::_getChunk()
 {
-  m_bodyElements.splice(m_bodyElements.end(), elements.m_bodyElements);
+  if (!m_elements)
+    return nullptr;
+  m_closedSpan.reset();
+  if (m_elements == &m_bodyElements)
+    m_bufferedSize += sizeof(ABWOutputEvent);
+  if (m_elements->empty() || m_elements->back()->isFull())
+  {
+    // all the body chunks are complete now
+    if (m_elements == &m_bodyElements && m_spillThreshold && m_bufferedSize > m_spillThreshold)
+      _spillChunks();
+    // start small, as most frames, headers and footers only have a few events
+    if (m_elements->empty() && !m_spareChunks.empty())
+    {
+      m_elements->push_back(std::move(m_spareChunks.back()));
+      m_spareChunks.pop_back();
+    }
+    else
+    {
+      const unsigned capacity = m_elements->empty() ? ABW_MIN_OUTPUT_CHUNK_SIZE
+                                : std::min(2 * m_elements->back()->m_capacity, unsigned(ABW_MAX_OUTPUT_CHUNK_SIZE));
+      m_elements->push_back(std::unique_ptr<ABWOutputChunk>(new ABWOutputChunk(capacity)));
+    }
+  }
+  return m_elements->back().get();
 }
 
-void libabw::ABWOutputElements::write(librevenge::RVNGTextInterface *iface) const
+void libabw::ABWOutputElements::_keepSpareChunk(OutputElements_t &elements)
 {
-  OutputElements_t::const_iterator iter;
-  for (iter = m_bodyElements.begin(); iter != m_bodyElements.end(); ++iter)
-    (*iter)->write(iface, &m_footerElements, &m_headerElements);
+  if (elements.empty() || m_spareChunks.size() >= ABW_MAX_SPARE_OUTPUT_CHUNKS)
+    return;
+  elements.front()->clear();
+  m_spareChunks.push_back(std::move(elements.front()));
+  elements.pop_front();
 }
 
 void libabw::ABWOutputElements::addCloseEndnote()
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWCloseEndnoteElement>());
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_CLOSE_ENDNOTE);
 }
 
 void libabw::ABWOutputElements::addCloseFooter()
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWCloseFooterElement>());
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_CLOSE_FOOTER);
   m_elements = &m_bodyElements;
 }
 
 void libabw::ABWOutputElements::addCloseFootnote()
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWCloseFootnoteElement>());
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_CLOSE_FOOTNOTE);
 }
 
 void libabw::ABWOutputElements::addCloseFrame()
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWCloseFrameElement>());
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_CLOSE_FRAME);
 }
 
 void libabw::ABWOutputElements::addCloseHeader()
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWCloseHeaderElement>());
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_CLOSE_HEADER);
   m_elements = &m_bodyElements;
 }
 
 void libabw::ABWOutputElements::addCloseLink()
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWCloseLinkElement>());
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_CLOSE_LINK);
 }
 
 void libabw::ABWOutputElements::addCloseListElement()
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWCloseListElementElement>());
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_CLOSE_LIST_ELEMENT);
 }
 
 void libabw::ABWOutputElements::addCloseOrderedListLevel()
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWCloseOrderedListLevelElement>());
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_CLOSE_ORDERED_LIST_LEVEL);
 }
 
 void libabw::ABWOutputElements::addClosePageSpan()
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWClosePageSpanElement>());
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_CLOSE_PAGE_SPAN);
 }
 
 void libabw::ABWOutputElements::addCloseParagraph()
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWCloseParagraphElement>());
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_CLOSE_PARAGRAPH);
 }
 
 void libabw::ABWOutputElements::addCloseSection()
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWCloseSectionElement>());
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_CLOSE_SECTION);
 }
 
 void libabw::ABWOutputElements::addCloseSpan()
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWCloseSpanElement>());
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_CLOSE_SPAN);
+  if (m_isMergingEvents && !m_openSpans.empty())
+  {
+    m_closedSpan = m_openSpans.back();
+    m_openSpans.pop_back();
+  }
 }
 
 void libabw::ABWOutputElements::addCloseTable()
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWCloseTableElement>());
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_CLOSE_TABLE);
 }
 
 void libabw::ABWOutputElements::addCloseTableCell()
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWCloseTableCellElement>());
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_CLOSE_TABLE_CELL);
 }
 
 void libabw::ABWOutputElements::addCloseTableRow()
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWCloseTableRowElement>());
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_CLOSE_TABLE_ROW);
 }
 
 void libabw::ABWOutputElements::addCloseTextBox()
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWCloseTextBoxElement>());
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_CLOSE_TEXT_BOX);
 }
 
 void libabw::ABWOutputElements::addCloseUnorderedListLevel()
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWCloseUnorderedListLevelElement>());
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_CLOSE_UNORDERED_LIST_LEVEL);
 }
 
 void libabw::ABWOutputElements::addInsertBinaryObject(const librevenge::RVNGPropertyList &propList)
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWInsertBinaryObjectElement>(propList));
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_INSERT_BINARY_OBJECT, propList);
 }
 
 void libabw::ABWOutputElements::addInsertField(const librevenge::RVNGPropertyList &propList)
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWInsertFieldElement>(propList));
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_INSERT_FIELD, propList);
+}
+
+void libabw::ABWOutputElements::addInsertImage(const librevenge::RVNGPropertyList &propList, const std::string &dataId,
+                                               ABWDataMap &data)
+{
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+  {
+    data.addUse(dataId);
+    chunk->m_images.push_back(ABWOutputImage(dataId, data));
+    chunk->add(ABW_OUTPUT_INSERT_IMAGE, propList, unsigned(chunk->m_images.size() - 1));
+  }
+}
+
+void libabw::ABWOutputElements::addInsertImageData(const std::string &dataId, ABWDataMap &data)
+{
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+  {
+    data.addUse(dataId);
+    chunk->m_images.push_back(ABWOutputImage(dataId, data));
+    chunk->add(ABW_OUTPUT_INSERT_IMAGE_DATA, unsigned(chunk->m_images.size() - 1));
+  }
 }
 
 void libabw::ABWOutputElements::addInsertCoveredTableCell(const librevenge::RVNGPropertyList &propList)
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWInsertCoveredTableCellElement>(propList));
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_INSERT_COVERED_TABLE_CELL, propList);
 }
 
 void libabw::ABWOutputElements::addInsertLineBreak()
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWInsertLineBreakElement>());
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_INSERT_LINE_BREAK);
 }
 
 void libabw::ABWOutputElements::addInsertSpace()
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWInsertSpaceElement>());
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_INSERT_SPACE);
 }
 
 void libabw::ABWOutputElements::addInsertTab()
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWInsertTabElement>());
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_INSERT_TAB);
 }
 
 void libabw::ABWOutputElements::addInsertText(const librevenge::RVNGString &text)
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWInsertTextElement>(text));
+  ABWOutputChunk *chunk = m_isMergingEvents ? _getLastEventChunk(ABW_OUTPUT_INSERT_TEXT) : nullptr;
+  if (chunk)
+  {
+    // append to the previous text
+    m_closedSpan.reset();
+    if (m_elements == &m_bodyElements)
+      m_bufferedSize += text.size();
+    chunk->m_texts[chunk->m_events.back().m_extra].append(text);
+    return;
+  }
+  chunk = _getChunk();
+  if (chunk)
+  {
+    if (m_elements == &m_bodyElements)
+      m_bufferedSize += text.size();
+    chunk->m_texts.push_back(text);
+    chunk->add(ABW_OUTPUT_INSERT_TEXT, unsigned(chunk->m_texts.size() - 1));
+  }
 }
 
 void libabw::ABWOutputElements::addOpenEndnote(const librevenge::RVNGPropertyList &propList)
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWOpenEndnoteElement>(propList));
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_OPEN_ENDNOTE, propList);
 }
 
 void libabw::ABWOutputElements::addOpenFooter(const librevenge::RVNGPropertyList &propList, int id)
@@ -1071,103 +1090,165 @@ void libabw::ABWOutputElements::addOpenFooter(const librevenge::RVNGPropertyList
   // already exists, this might be a footer with different occurrence and we will add it to
   // the existing one.
   m_elements = &m_footerElements[id];
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWOpenFooterElement>(propList));
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_OPEN_FOOTER, propList);
 }
 
 void libabw::ABWOutputElements::addOpenFootnote(const librevenge::RVNGPropertyList &propList)
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWOpenFootnoteElement>(propList));
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_OPEN_FOOTNOTE, propList);
 }
 
 void libabw::ABWOutputElements::addOpenFrame(const librevenge::RVNGPropertyList &propList)
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWOpenFrameElement>(propList));
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_OPEN_FRAME, propList);
 }
 
 void libabw::ABWOutputElements::addOpenHeader(const librevenge::RVNGPropertyList &propList, int id)
 {
   // Check the comment in addOpenFooter to see what happens here
   m_elements = &m_headerElements[id];
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWOpenHeaderElement>(propList));
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_OPEN_HEADER, propList);
 }
 
-void libabw::ABWOutputElements::addOpenListElement(const librevenge::RVNGPropertyList &propList)
+void libabw::ABWOutputElements::addOpenListElement(const ABWPropertyListPool::Handle &propList)
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWOpenListElementElement>(propList));
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_OPEN_LIST_ELEMENT, propList);
 }
 
 void libabw::ABWOutputElements::addOpenLink(const librevenge::RVNGPropertyList &propList)
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWOpenLinkElement>(propList));
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_OPEN_LINK, propList);
+}
+
+void libabw::ABWOutputElements::addOpenListLevel(const std::shared_ptr<const ABWListElement> &listElement, int listId)
+{
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+  {
+    chunk->m_listLevels.push_back(ABWOutputListLevel(listElement, listId));
+    chunk->add(ABW_OUTPUT_OPEN_LIST_LEVEL, unsigned(chunk->m_listLevels.size() - 1));
+  }
 }
 
 void libabw::ABWOutputElements::addOpenOrderedListLevel(const librevenge::RVNGPropertyList &propList)
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWOpenOrderedListLevelElement>(propList));
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_OPEN_ORDERED_LIST_LEVEL, propList);
 }
 
 void libabw::ABWOutputElements::addOpenPageSpan(const librevenge::RVNGPropertyList &propList,
                                                 int footer, int footerLeft, int footerFirst, int footerLast,
                                                 int header, int headerLeft, int headerFirst, int headerLast)
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWOpenPageSpanElement>(propList, footer, footerLeft, footerFirst, footerLast,
-                                                              header, headerLeft, headerFirst, headerLast));
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+  {
+    chunk->m_pageSpans.push_back(ABWOutputPageSpan(footer, footerLeft, footerFirst, footerLast,
+                                                   header, headerLeft, headerFirst, headerLast));
+    chunk->add(ABW_OUTPUT_OPEN_PAGE_SPAN, propList, unsigned(chunk->m_pageSpans.size() - 1));
+  }
 }
 
-void libabw::ABWOutputElements::addOpenParagraph(const librevenge::RVNGPropertyList &propList)
+void libabw::ABWOutputElements::addOpenParagraph(const ABWPropertyListPool::Handle &propList)
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWOpenParagraphElement>(propList));
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_OPEN_PARAGRAPH, propList);
 }
 
 void libabw::ABWOutputElements::addOpenSection(const librevenge::RVNGPropertyList &propList)
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWOpenSectionElement>(propList));
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_OPEN_SECTION, propList);
 }
 
-void libabw::ABWOutputElements::addOpenSpan(const librevenge::RVNGPropertyList &propList)
+void libabw::ABWOutputElements::addOpenSpan(const ABWPropertyListPool::Handle &propList)
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWOpenSpanElement>(propList));
+  if (m_isMergingEvents)
+  {
+    m_openSpans.push_back(propList);
+    // m_closedSpan is only set if the span was closed by the last event
+    ABWOutputChunk *const lastChunk = m_closedSpan == propList ? _getLastEventChunk(ABW_OUTPUT_CLOSE_SPAN) : nullptr;
+    if (lastChunk)
+    {
+      // continue the span instead
+      lastChunk->m_events.pop_back();
+      if (m_elements == &m_bodyElements && m_bufferedSize >= sizeof(ABWOutputEvent))
+        m_bufferedSize -= sizeof(ABWOutputEvent);
+      m_closedSpan.reset();
+      return;
+    }
+  }
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_OPEN_SPAN, propList);
 }
 
-void libabw::ABWOutputElements::addOpenTable(const librevenge::RVNGPropertyList &propList)
+void libabw::ABWOutputElements::addOpenTable(const librevenge::RVNGPropertyList &propList, const librevenge::RVNGPropertyListVector &columns,
+                                             int tableId, const std::map<int, int> &tableSizes)
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWOpenTableElement>(propList));
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+  {
+    chunk->m_tables.push_back(ABWOutputTable(columns, tableId, tableSizes));
+    chunk->add(ABW_OUTPUT_OPEN_TABLE, propList, unsigned(chunk->m_tables.size() - 1));
+  }
 }
 
 void libabw::ABWOutputElements::addOpenTableCell(const librevenge::RVNGPropertyList &propList)
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWOpenTableCellElement>(propList));
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_OPEN_TABLE_CELL, propList);
 }
 
 void libabw::ABWOutputElements::addOpenTableRow(const librevenge::RVNGPropertyList &propList)
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWOpenTableRowElement>(propList));
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_OPEN_TABLE_ROW, propList);
 }
 
 void libabw::ABWOutputElements::addOpenTextBox(const librevenge::RVNGPropertyList &propList)
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWOpenTextBoxElement>(propList));
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_OPEN_TEXT_BOX, propList);
 }
 
 void libabw::ABWOutputElements::addOpenUnorderedListLevel(const librevenge::RVNGPropertyList &propList)
 {
-  if (m_elements)
-    m_elements->push_back(make_unique<ABWOpenUnorderedListLevelElement>(propList));
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_OPEN_UNORDERED_LIST_LEVEL, propList);
+}
+
+void libabw::ABWOutputElements::addSetDocumentMetaData(const librevenge::RVNGPropertyList &propList)
+{
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_SET_DOCUMENT_META_DATA, propList);
+}
+
+void libabw::ABWOutputElements::addStartDocument(const librevenge::RVNGPropertyList &propList)
+{
+  ABWOutputChunk *const chunk = _getChunk();
+  if (chunk)
+    chunk->add(ABW_OUTPUT_START_DOCUMENT, propList);
 }
 
 /* vim:set shiftwidth=2 softtabstop=2 expandtab: */
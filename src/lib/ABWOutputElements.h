@@ -10,27 +10,109 @@
 #ifndef ABWOUTPUTELEMENTS_H
 #define ABWOUTPUTELEMENTS_H
 
+#include <cstdio>
 #include <list>
 #include <map>
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <librevenge/librevenge.h>
 
+#include "ABWCollector.h"
+
 namespace libabw
 {
 
-class ABWOutputElement;
+struct ABWOutputChunk;
+
+/** Property lists shared by the output events which use the same one.
+
+    A list is identified by a key built by the caller from the values it
+    depends on, as librevenge offers no exact way to compare lists. The
+    handles stay valid after the pool forgets about a list.
+  */
+class ABWPropertyListPool
+{
+public:
+  typedef std::shared_ptr<const librevenge::RVNGPropertyList> Handle;
 
+  struct Stats
+  {
+    Stats() : m_lists(0), m_uses(0), m_savedBytes(0) {}
+
+    //! the number of lists stored
+    unsigned long m_lists;
+    //! the number of times they were given out, including the first one
+    unsigned long m_uses;
+    //! an estimate of the memory the copies of the reused lists would take
+    unsigned long m_savedBytes;
+  };
+
+  ABWPropertyListPool();
+  //! the list stored for key, or an empty handle
+  Handle find(const std::string &key);
+  Handle insert(const std::string &key, const librevenge::RVNGPropertyList &propList);
+  const Stats &getStats() const;
+
+private:
+  struct Entry
+  {
+    Entry() : m_propList(), m_size(0) {}
+
+    Handle m_propList;
+    unsigned long m_size;
+  };
+
+  std::unordered_map<std::string, Entry> m_entries;
+  Stats m_stats;
+};
+
+/** The output events of a document, recorded to be written once it is complete.
+
+    The events are stored as tagged records in chunks, each chunk holding
+    the arguments of its events, so that splicing moves whole chunks. A
+    single chunk which fits in the room left in the last body chunk is
+    copied there instead, and clear() keeps the first chunk of each list,
+    so that the elements of a frame can be reused without allocating.
+
+    If a spill threshold is set, the records and the texts of the completed
+    body chunks are moved to a temporary file once they take more memory
+    than the threshold, and read back when they are written. The property
+    lists stay in memory, as librevenge can not serialize them exactly.
+
+    If merging is enabled, a span opened with the same property list as
+    the one just closed continues it, and consecutive texts are recorded
+    as one, so that the generator gets fewer callbacks for the same output.
+  */
 class ABWOutputElements
 {
 public:
-  typedef std::list<std::unique_ptr<ABWOutputElement>> OutputElements_t;
+  typedef std::list<std::unique_ptr<ABWOutputChunk>> OutputElements_t;
   typedef std::map<int, OutputElements_t> OutputElementsMap_t;
 
   ABWOutputElements();
   virtual ~ABWOutputElements();
+  //! the elements given must not have been spilled
   void splice(ABWOutputElements &elements);
-  void write(librevenge::RVNGTextInterface *iface) const;
+  //! drops all the events, keeping emptied chunks to add the next ones to
+  void clear();
+  //! false if a part of the body could not be read back from the spill file
+  bool write(librevenge::RVNGTextInterface *iface);
+  /** Writes the body events, up to the first page span using a header or
+      a footer which is not complete yet, and drops them.
+
+      Returns false if a part of the body could not be read back from the spill file.
+    */
+  bool flush(librevenge::RVNGTextInterface *iface);
+  /** Moves the records and the texts of the body to the spill file once they take more than threshold bytes.
+
+      Only they are counted: the property lists, tables, page spans, images and list levels stay in memory.
+      0 keeps everything in memory.
+    */
+  void setSpillThreshold(unsigned long threshold);
+  void setMergingEvents(bool merge);
   void addCloseEndnote();
   void addCloseFooter();
   void addCloseFootnote();
@@ -51,6 +133,9 @@ public:
   void addInsertBinaryObject(const librevenge::RVNGPropertyList &propList);
   void addInsertCoveredTableCell(const librevenge::RVNGPropertyList &propList);
   void addInsertField(const librevenge::RVNGPropertyList &propList);
+  void addInsertImage(const librevenge::RVNGPropertyList &propList, const std::string &dataId,
+                      ABWDataMap &data);
+  void addInsertImageData(const std::string &dataId, ABWDataMap &data);
   void addInsertLineBreak();
   void addInsertSpace();
   void addInsertTab();
@@ -61,19 +146,22 @@ public:
   void addOpenFrame(const librevenge::RVNGPropertyList &propList);
   void addOpenHeader(const librevenge::RVNGPropertyList &propList, int id);
   void addOpenLink(const librevenge::RVNGPropertyList &propList);
-  void addOpenListElement(const librevenge::RVNGPropertyList &propList);
+  void addOpenListElement(const ABWPropertyListPool::Handle &propList);
+  void addOpenListLevel(const std::shared_ptr<const ABWListElement> &listElement, int listId);
   void addOpenOrderedListLevel(const librevenge::RVNGPropertyList &propList);
   void addOpenPageSpan(const librevenge::RVNGPropertyList &propList,
                        int footer, int footerLeft, int footerFirst, int footerLast,
                        int header, int headerLeft, int headerFirst, int headerLast);
-  void addOpenParagraph(const librevenge::RVNGPropertyList &propList);
+  void addOpenParagraph(const ABWPropertyListPool::Handle &propList);
   void addOpenSection(const librevenge::RVNGPropertyList &propList);
-  void addOpenSpan(const librevenge::RVNGPropertyList &propList);
-  void addOpenTable(const librevenge::RVNGPropertyList &propList);
+  void addOpenSpan(const ABWPropertyListPool::Handle &propList);
+  void addOpenTable(const librevenge::RVNGPropertyList &propList, const librevenge::RVNGPropertyListVector &columns,
+                    int tableId, const std::map<int, int> &tableSizes);
   void addOpenTableCell(const librevenge::RVNGPropertyList &propList);
   void addOpenTableRow(const librevenge::RVNGPropertyList &propList);
   void addOpenTextBox(const librevenge::RVNGPropertyList &propList);
   void addOpenUnorderedListLevel(const librevenge::RVNGPropertyList &propList);
+  void addSetDocumentMetaData(const librevenge::RVNGPropertyList &propList);
   void addStartDocument(const librevenge::RVNGPropertyList &propList);
   bool empty() const
   {
@@ -82,10 +170,33 @@ public:
 private:
   ABWOutputElements(const ABWOutputElements &);
   ABWOutputElements &operator=(const ABWOutputElements &);
+  //! the chunk to which the next event of the current list is added
+  ABWOutputChunk *_getChunk();
+  bool _isComplete(int id, const OutputElementsMap_t &elements) const;
+  //! the chunk holding the last event of the current list, if it has this type and is not written yet
+  ABWOutputChunk *_getLastEventChunk(int type) const;
+  //! moves the first chunk of elements, emptied, to the spare chunks
+  void _keepSpareChunk(OutputElements_t &elements);
+  void _spillChunks();
+  bool _readChunk(ABWOutputChunk &chunk);
+
   OutputElements_t m_bodyElements;
   std::map<int, OutputElements_t > m_headerElements;
   std::map<int, OutputElements_t > m_footerElements;
   OutputElements_t *m_elements;
+  //! the number of events of the first body chunk which were already flushed
+  unsigned long m_flushedEvents;
+  unsigned long m_spillThreshold;
+  //! the size of the records and the texts of the body chunks kept in memory
+  unsigned long m_bufferedSize;
+  std::FILE *m_spillFile;
+  bool m_isMergingEvents;
+  //! the property lists of the open spans, when merging
+  std::vector<ABWPropertyListPool::Handle> m_openSpans;
+  //! the property list of the span closed by the last event added, if it was a close span
+  ABWPropertyListPool::Handle m_closedSpan;
+  //! emptied chunks kept by clear(), used to start the next lists
+  std::vector<std::unique_ptr<ABWOutputChunk>> m_spareChunks;
 };
 
 
@@ -9,16 +9,19 @@
 
 #include <string.h>
 
-#include <set>
 #include <stack>
 #include <utility>
+#include <vector>
 
 #include <libxml/xmlIO.h>
 #include <libxml/xmlstring.h>
 #include <librevenge-stream/librevenge-stream.h>
 #include <boost/spirit/include/qi.hpp>
 #include "ABWParser.h"
+#include "ABWBase64.h"
 #include "ABWContentCollector.h"
+#include "ABWEventLog.h"
+#include "ABWSinglePassCollector.h"
 #include "ABWStylesCollector.h"
 #include "libabw_internal.h"
 #include "ABWXMLHelper.h"
@@ -31,6 +34,19 @@ namespace libabw
 namespace
 {
 
+struct BoolSymbols : boost::spirit::qi::symbols<char, bool>
+{
+  BoolSymbols()
+  {
+    add
+    ("true", true)
+    ("false", false)
+    ("yes", true)
+    ("no", false)
+    ;
+  }
+};
+
 static bool findBool(const std::string &str, bool &res)
 {
   using namespace boost::spirit::qi;
@@ -38,62 +54,63 @@ static bool findBool(const std::string &str, bool &res)
   if (str.empty())
     return false;
 
-  symbols<char, bool> bools;
-  bools.add
-  ("true", true)
-  ("false", false)
-  ("yes", true)
-  ("no", false)
-  ;
+  static const BoolSymbols bools;
 
   auto it = str.cbegin();
   return phrase_parse(it, str.cend(), no_case[bools], space, res) && it == str.cend();
 }
 
+//! maximal size of the events recorded for the content pass
+static const unsigned long ABW_MAX_EVENT_LOG_SIZE = 32 * 1024 * 1024;
+
 // small function needed to call the xml BAD_CAST on a char const *
 static xmlChar *call_BAD_CAST_OnConst(char const *str)
 {
   return BAD_CAST(const_cast<char *>(str));
 }
 
-/** try to find the parent's level corresponding to a level with some id
-    and use its original id to define the list id.
-
-    Seen corresponds to the list of level that we have already examined,
-    it is used to check also for loop
-  */
-static int _findAndUpdateListElementId(std::map<int, std::shared_ptr<ABWListElement>> &listElements, int id, std::set<int> &seen)
+/* Looks for the <d> element between from and to whose content is exactly
+   the given text, so the text can be read again from the buffer later.
+ */
+static bool findDataPayload(const unsigned char *buffer, unsigned long size, unsigned long from, unsigned long to,
+                            const xmlChar *text, unsigned long length, unsigned long &offset)
 {
-  if (listElements.find(id)==listElements.end() || !listElements.find(id)->second)
-    return 0;
-  const std::shared_ptr<ABWListElement> &tmpElement= listElements.find(id)->second;
-  if (tmpElement->m_listId)
-    return tmpElement->m_listId;
-  if (seen.find(id)!=seen.end())
+  unsigned long pos = from;
+  while (pos < to)
   {
-    // oops, this means that we have a loop
-    tmpElement->m_parentId=0;
-  }
-  else
-    seen.insert(id);
-  if (!tmpElement->m_parentId)
-  {
-    tmpElement->m_listId=id;
-    return id;
-  }
-  tmpElement->m_listId=_findAndUpdateListElementId(listElements, tmpElement->m_parentId, seen);
-  return tmpElement->m_listId;
-}
+    const auto *lt = static_cast<const unsigned char *>(memchr(buffer + pos, '<', to - pos));
+    if (!lt)
+      return false;
+    pos = (unsigned long)(lt - buffer) + 1;
+    if (pos + 1 >= size || buffer[pos] != 'd' || !strchr(" \t\r\n>", buffer[pos + 1]))
+      continue;
+
+    // find the end of the start tag
+    unsigned long i = pos + 1;
+    unsigned char quote = 0;
+    for (; i < size; ++i)
+    {
+      if (quote)
+      {
+        if (buffer[i] == quote)
+          quote = 0;
+      }
+      else if (buffer[i] == '"' || buffer[i] == '\'')
+        quote = buffer[i];
+      else if (buffer[i] == '>')
+        break;
+    }
+    if (i >= size || buffer[i - 1] == '/')
+      continue;
 
-/** try to update the final list id for each list elements */
-static void updateListElementIds(std::map<int, std::shared_ptr<ABWListElement>> &listElements)
-{
-  std::set<int> seens;
-  for (const auto &elem : listElements)
-  {
-    if (!elem.second) continue;
-    _findAndUpdateListElementId(listElements, elem.first, seens);
+    const unsigned long start = i + 1;
+    if (start + length < size && buffer[start + length] == '<' && !memcmp(buffer + start, text, length))
+    {
+      offset = start;
+      return true;
+    }
   }
+  return false;
 }
 
 } // anonymous namespace
@@ -103,23 +120,54 @@ struct ABWParserState
   ABWParserState();
   ~ABWParserState();
   std::map<int, int> m_tableSizes;
-  std::map<std::string, ABWData> m_data;
+  ABWDataMap m_data;
   std::map<int, std::shared_ptr<ABWListElement>> m_listElements;
+  //! the text styles, shared by the content collectors of the document and of its frames
+  ABWStyleRegistry m_styles;
+  //! the span property lists, shared likewise
+  ABWPropertyListPool m_spanPropLists;
+  //! the paragraph property lists, shared likewise
+  ABWPropertyListPool m_paragraphPropLists;
+  //! startDocument and metadata, recorded by the content collector of the document
+  ABWOutputElements m_documentElements;
+
+  //! the document, when it is parsed in place
+  const unsigned char *m_inPlaceData;
+  unsigned long m_inPlaceSize;
+  //! where to look for the next data payload in m_inPlaceData
+  unsigned long m_dataSearchPos;
 
   bool m_inMetadata;
   std::string m_currentMetadataKey;
   bool m_inStyleParsing;
+  //! the styles collector, when the styles are collected together with the content
+  std::unique_ptr<ABWStylesCollector> m_stylesCollector;
   std::stack<std::unique_ptr<ABWCollector> > m_collectorStack;
+  //! the collectors of the closed frames, ready to be reused by the next ones
+  std::vector<std::unique_ptr<ABWCollector> > m_frameCollectors;
+
+private:
+  ABWParserState(const ABWParserState &);
+  ABWParserState &operator=(const ABWParserState &);
 };
 
 ABWParserState::ABWParserState()
   : m_tableSizes()
   , m_data()
   , m_listElements()
+  , m_styles()
+  , m_spanPropLists()
+  , m_paragraphPropLists()
+  , m_documentElements()
+  , m_inPlaceData(nullptr)
+  , m_inPlaceSize(0)
+  , m_dataSearchPos(0)
   , m_inMetadata(false)
   , m_currentMetadataKey()
   , m_inStyleParsing(false)
+  , m_stylesCollector()
   , m_collectorStack()
+  , m_frameCollectors()
 {
 }
 
@@ -128,8 +176,10 @@ ABWParserState::~ABWParserState()
 }
 } // namespace libabw
 
-libabw::ABWParser::ABWParser(librevenge::RVNGInputStream *input, librevenge::RVNGTextInterface *iface)
-  : m_input(input), m_iface(iface), m_collector(), m_state(new ABWParserState())
+libabw::ABWParser::ABWParser(librevenge::RVNGInputStream *input, librevenge::RVNGTextInterface *iface,
+                             const bool streaming, const unsigned long spillThreshold, const bool mergeEvents)
+  : m_input(input), m_iface(iface), m_streaming(streaming), m_spillThreshold(spillThreshold), m_mergeEvents(mergeEvents)
+  , m_loggedEvents(0), m_loggedBytes(0), m_eventLogTruncated(false), m_collector(), m_state(new ABWParserState())
 {
 }
 
@@ -144,15 +194,47 @@ bool libabw::ABWParser::parse()
 
   try
   {
-    m_collector.reset(new ABWStylesCollector(m_state->m_tableSizes, m_state->m_data, m_state->m_listElements));
+    // the output written while streaming can not be taken back, so the
+    // styles must be known before the content is collected
+    if (!m_streaming)
+    {
+      // collect the styles and the content in the same pass
+      m_state->m_stylesCollector.reset(new ABWStylesCollector(m_state->m_tableSizes, m_state->m_data, m_state->m_listElements));
+      m_collector.reset(createContentCollector(true));
+      m_input->seek(0, librevenge::RVNG_SEEK_SET);
+      m_state->m_inStyleParsing=false;
+      if (!processXmlDocument(m_input))
+        return false;
+      if (!m_state->m_stylesCollector->listsChangedAfterUse())
+        return m_state->m_collectorStack.empty();
+
+      // some paragraphs were collected with a list structure different from
+      // the final one: start again
+      ABW_DEBUG_MSG(("libabw::ABWParser::parse: the lists changed after their use, parsing again\n"));
+      m_collector.reset();
+      m_state.reset(new ABWParserState());
+    }
+
+    // collect the styles in a first pass which records the events for the content pass
+    auto *events = new ABWEventLog(new ABWStylesCollector(m_state->m_tableSizes, m_state->m_data, m_state->m_listElements),
+                                   ABW_MAX_EVENT_LOG_SIZE);
+    m_collector.reset(events);
     m_input->seek(0, librevenge::RVNG_SEEK_SET);
     m_state->m_inStyleParsing=true;
     if (!processXmlDocument(m_input))
       return false;
-    updateListElementIds(m_state->m_listElements);
-    m_collector.reset(new ABWContentCollector(m_iface, m_state->m_tableSizes, m_state->m_data, m_state->m_listElements));
-    m_input->seek(0, librevenge::RVNG_SEEK_SET);
+    std::unique_ptr<ABWCollector> eventLog(std::move(m_collector)); // owns events
+    m_collector.reset(createContentCollector(true));
     m_state->m_inStyleParsing=false;
+    m_loggedEvents = events->eventCount();
+    m_loggedBytes = events->size();
+    m_eventLogTruncated = !events->isComplete();
+    if (events->isComplete())
+    {
+      ABW_DEBUG_MSG(("libabw::ABWParser::parse: replaying %lu events, %lu bytes\n", events->eventCount(), events->size()));
+      return replayEvents(*events) && m_state->m_collectorStack.empty();
+    }
+    m_input->seek(0, librevenge::RVNG_SEEK_SET);
     return processXmlDocument(m_input) && m_state->m_collectorStack.empty();
   }
   catch (...)
@@ -167,9 +249,15 @@ bool libabw::ABWParser::processXmlDocument(librevenge::RVNGInputStream *input)
     return false;
 
   ABWXMLProgressWatcher watcher;
-  auto reader(xmlReaderForStream(input, &watcher));
+  m_state->m_inPlaceData = nullptr;
+  m_state->m_inPlaceSize = 0;
+  m_state->m_dataSearchPos = 0;
+  auto reader(xmlReaderForStream(input, &watcher, &m_state->m_inPlaceData, &m_state->m_inPlaceSize));
   if (!reader)
     return false;
+  // all the passes parse the same document, so the offsets of lazy data stay valid
+  if (m_state->m_inPlaceData)
+    m_state->m_data.setSource(m_state->m_inPlaceData, m_state->m_inPlaceSize);
   int ret = xmlTextReaderRead(reader.get());
   while (1 == ret && !watcher.isStuck())
   {
@@ -178,9 +266,56 @@ bool libabw::ABWParser::processXmlDocument(librevenge::RVNGInputStream *input)
       ret = xmlTextReaderRead(reader.get());
   }
 
+  if (ret != 0 || watcher.isStuck())
+    return false;
   if (m_collector)
+  {
     m_collector->endDocument();
-  return ret == 0 && !watcher.isStuck();
+    return m_collector->isOutputComplete();
+  }
+  return true;
+}
+
+bool libabw::ABWParser::replayEvents(const ABWEventLog &events)
+{
+  unsigned long pos = 0;
+  ABWLoggedEvent event;
+  while (events.readEvent(pos, event))
+  {
+    if (event.m_type == ABW_EVENT_OPEN_FRAME)
+      openFrame(event.m_args[0], event.m_args[1], event.m_args[2], event.m_args[3]);
+    else if (event.m_type == ABW_EVENT_CLOSE_FRAME)
+      readCloseFrame();
+    else if (m_collector)
+      event.dispatch(*m_collector);
+  }
+  return pos == events.size() && (!m_collector || m_collector->isOutputComplete());
+}
+
+void libabw::ABWParser::getStatistics(AbiDocumentStatistics &statistics) const
+{
+  const ABWPropertyListPool::Stats &spanStats = m_state->m_spanPropLists.getStats();
+  const ABWPropertyListPool::Stats &paragraphStats = m_state->m_paragraphPropLists.getStats();
+  statistics.m_spanPropListsBuilt = spanStats.m_lists;
+  statistics.m_spanPropListsReused = spanStats.m_uses - spanStats.m_lists;
+  statistics.m_paragraphPropListsBuilt = paragraphStats.m_lists;
+  statistics.m_paragraphPropListsReused = paragraphStats.m_uses - paragraphStats.m_lists;
+  statistics.m_savedBytes = spanStats.m_savedBytes + paragraphStats.m_savedBytes;
+  statistics.m_loggedEvents = m_loggedEvents;
+  statistics.m_loggedBytes = m_loggedBytes;
+  statistics.m_eventLogTruncated = m_eventLogTruncated;
+}
+
+libabw::ABWCollector *libabw::ABWParser::createContentCollector(const bool isDocument)
+{
+  // the output of the frames is added to the one of the document, which is the only one written
+  auto *collector = new ABWContentCollector(m_iface, m_state->m_tableSizes, m_state->m_data, m_state->m_listElements,
+                                            m_state->m_styles, m_state->m_spanPropLists, m_state->m_paragraphPropLists,
+                                            isDocument ? &m_state->m_documentElements : nullptr,
+                                            isDocument && m_streaming, isDocument ? m_spillThreshold : 0, m_mergeEvents);
+  if (m_state->m_stylesCollector)
+    return new ABWSinglePassCollector(*m_state->m_stylesCollector, collector);
+  return collector;
 }
 
 int libabw::ABWParser::processXmlNode(xmlTextReaderPtr reader)
@@ -239,15 +374,15 @@ int libabw::ABWParser::processXmlNode(xmlTextReaderPtr reader)
     break;
   case XML_HISTORY:
     if (XML_READER_TYPE_ELEMENT == tokenType)
-      ret = readHistory(reader);
+      ret = skipElement(reader);
     break;
   case XML_REVISIONS:
     if (XML_READER_TYPE_ELEMENT == tokenType)
-      ret = readRevisions(reader);
+      ret = skipElement(reader);
     break;
   case XML_IGNOREDWORDS:
     if (XML_READER_TYPE_ELEMENT == tokenType)
-      ret = readIgnoredWords(reader);
+      ret = skipElement(reader);
     break;
   case XML_S:
     if (XML_READER_TYPE_ELEMENT == tokenType)
@@ -394,79 +529,6 @@ void libabw::ABWParser::readM(xmlTextReaderPtr reader)
     m_state->m_currentMetadataKey = static_cast<const char *>(key);
 }
 
-int libabw::ABWParser::readHistory(xmlTextReaderPtr reader)
-{
-  int ret = 1;
-  int tokenId = XML_TOKEN_INVALID;
-  int tokenType = -1;
-  do
-  {
-    ret = xmlTextReaderRead(reader);
-    tokenId = getElementToken(reader);
-    if (XML_TOKEN_INVALID == tokenId)
-    {
-      ABW_DEBUG_MSG(("ABWParser::readHistory: unknown token %s\n", xmlTextReaderConstName(reader)));
-    }
-    tokenType = xmlTextReaderNodeType(reader);
-    switch (tokenId)
-    {
-    default:
-      break;
-    }
-  }
-  while ((XML_HISTORY != tokenId || XML_READER_TYPE_END_ELEMENT != tokenType) && 1 == ret);
-  return ret;
-}
-
-int libabw::ABWParser::readRevisions(xmlTextReaderPtr reader)
-{
-  int ret = 1;
-  int tokenId = XML_TOKEN_INVALID;
-  int tokenType = -1;
-  do
-  {
-    ret = xmlTextReaderRead(reader);
-    tokenId = getElementToken(reader);
-    if (XML_TOKEN_INVALID == tokenId)
-    {
-      ABW_DEBUG_MSG(("ABWParser::readRevisions: unknown token %s\n", xmlTextReaderConstName(reader)));
-    }
-    tokenType = xmlTextReaderNodeType(reader);
-    (void)tokenType;
-    switch (tokenId)
-    {
-    default:
-      break;
-    }
-  }
-  while ((XML_REVISIONS != tokenId || XML_READER_TYPE_END_ELEMENT != tokenType) && 1 == ret);
-  return ret;
-}
-
-int libabw::ABWParser::readIgnoredWords(xmlTextReaderPtr reader)
-{
-  int ret = 1;
-  int tokenId = XML_TOKEN_INVALID;
-  int tokenType = -1;
-  do
-  {
-    ret = xmlTextReaderRead(reader);
-    tokenId = getElementToken(reader);
-    if (XML_TOKEN_INVALID == tokenId)
-    {
-      ABW_DEBUG_MSG(("ABWParser::readIgnoreWords: unknown token %s\n", xmlTextReaderConstName(reader)));
-    }
-    tokenType = xmlTextReaderNodeType(reader);
-    switch (tokenId)
-    {
-    default:
-      break;
-    }
-  }
-  while ((XML_IGNOREDWORDS != tokenId || XML_READER_TYPE_END_ELEMENT != tokenType) && 1 == ret);
-  return ret;
-}
-
 void libabw::ABWParser::readPageSize(xmlTextReaderPtr reader)
 {
   ABWXMLString width = xmlTextReaderGetAttribute(reader, call_BAD_CAST_OnConst("width"));
@@ -507,8 +569,47 @@ void libabw::ABWParser::readSection(xmlTextReaderPtr reader)
   }
 }
 
+int libabw::ABWParser::skipElement(xmlTextReaderPtr reader)
+{
+  if (xmlTextReaderIsEmptyElement(reader) > 0)
+    return 1;
+
+  // stop at the end element, like the read* functions do
+  const int depth = xmlTextReaderDepth(reader);
+  int ret = 1;
+  int currentDepth = depth;
+  do
+  {
+    ret = xmlTextReaderRead(reader);
+    currentDepth = xmlTextReaderDepth(reader);
+  }
+  while (1 == ret && (currentDepth > depth || (currentDepth == depth && XML_READER_TYPE_END_ELEMENT != xmlTextReaderNodeType(reader))));
+  return ret;
+}
+
+bool libabw::ABWParser::findDataOffset(xmlTextReaderPtr reader, const xmlChar *text, unsigned long &offset)
+{
+  if (!m_state->m_inPlaceData)
+    return false;
+
+  // the parser has already gone past the text
+  const long consumed = xmlTextReaderByteConsumed(reader);
+  unsigned long end = m_state->m_inPlaceSize;
+  if (consumed > 0 && (unsigned long) consumed < end)
+    end = (unsigned long) consumed;
+
+  const auto length = (unsigned long) xmlStrlen(text);
+  if (!findDataPayload(m_state->m_inPlaceData, m_state->m_inPlaceSize, m_state->m_dataSearchPos, end, text, length, offset))
+    return false;
+  m_state->m_dataSearchPos = offset + length;
+  return true;
+}
+
 int libabw::ABWParser::readD(xmlTextReaderPtr reader)
 {
+  if (!m_collector || !m_collector->isDataCollected())
+    return skipElement(reader);
+
   ABWXMLString name = xmlTextReaderGetAttribute(reader, call_BAD_CAST_OnConst("name"));
   ABWXMLString mimeType = xmlTextReaderGetAttribute(reader, call_BAD_CAST_OnConst("mime-type"));
 
@@ -537,11 +638,19 @@ int libabw::ABWParser::readD(xmlTextReaderPtr reader)
     case XML_READER_TYPE_CDATA:
     {
       const xmlChar *data = xmlTextReaderConstValue(reader);
-      if (data)
+      unsigned long offset = 0;
+      if (data && name && XML_READER_TYPE_TEXT == tokenType && findDataOffset(reader, data, offset))
+      {
+        // the data are in the document buffer as they are: only remember
+        // where, they are decoded when they are used
+        m_state->m_data.insertLazy((const char *)name, mimeType ? (const char *)mimeType : "",
+                                   offset, (unsigned long) xmlStrlen(data), base64);
+      }
+      else if (data)
       {
         librevenge::RVNGBinaryData binaryData;
         if (base64)
-          binaryData.appendBase64Data((const char *)data);
+          appendBase64Data(binaryData, (const char *)data, (unsigned long) xmlStrlen(data));
         else
           binaryData.append(data, (unsigned long) xmlStrlen(data));
         if (m_collector)
@@ -663,12 +772,25 @@ void libabw::ABWParser::readFrame(xmlTextReaderPtr reader)
   ABWXMLString imageId = xmlTextReaderGetAttribute(reader, call_BAD_CAST_OnConst("strux-image-dataid"));
   ABWXMLString title = xmlTextReaderGetAttribute(reader, call_BAD_CAST_OnConst("title"));
   ABWXMLString alt = xmlTextReaderGetAttribute(reader, call_BAD_CAST_OnConst("alt"));
+  openFrame((const char *)props, (const char *) imageId, (const char *) title, (const char *) alt);
+}
+
+void libabw::ABWParser::openFrame(const char *props, const char *imageId, const char *title, const char *alt)
+{
+  if (!m_collector)
+    return;
   if (!m_state->m_inStyleParsing)
   {
     m_state->m_collectorStack.push(std::move(m_collector));
-    m_collector.reset(new ABWContentCollector(m_iface, m_state->m_tableSizes, m_state->m_data, m_state->m_listElements));
+    if (m_state->m_frameCollectors.empty())
+      m_collector.reset(createContentCollector(false));
+    else
+    {
+      m_collector = std::move(m_state->m_frameCollectors.back());
+      m_state->m_frameCollectors.pop_back();
+    }
   }
-  m_collector->openFrame((const char *)props, (const char *) imageId, (const char *) title, (const char *) alt);
+  m_collector->openFrame(props, imageId, title, alt);
 }
 
 void libabw::ABWParser::readCloseFrame()
@@ -688,7 +810,10 @@ void libabw::ABWParser::readCloseFrame()
   if (elements)
     m_state->m_collectorStack.top()->addFrameElements(*elements, pageFrame);
   m_collector.swap(m_state->m_collectorStack.top());
+  std::unique_ptr<ABWCollector> frameCollector(std::move(m_state->m_collectorStack.top()));
   m_state->m_collectorStack.pop();
+  if (frameCollector->reset())
+    m_state->m_frameCollectors.push_back(std::move(frameCollector));
 }
 
 void libabw::ABWParser::readL(xmlTextReaderPtr reader)
@@ -13,20 +13,32 @@
 #include <memory>
 
 #include <librevenge/librevenge.h>
+#include <libabw/libabw.h>
 #include "ABWXMLHelper.h"
 
 namespace libabw
 {
 
 class ABWCollector;
+class ABWEventLog;
 struct ABWParserState;
 
 class ABWParser
 {
 public:
-  explicit ABWParser(librevenge::RVNGInputStream *input, librevenge::RVNGTextInterface *iface);
+  /** If streaming is set, the body is written while the content is
+      collected, instead of at the end of the document. Else, if
+      spillThreshold is not 0, the buffered body is moved to a temporary
+      file when it takes more than spillThreshold bytes. If mergeEvents is
+      set, adjacent spans with the same properties and consecutive texts
+      are merged.
+    */
+  ABWParser(librevenge::RVNGInputStream *input, librevenge::RVNGTextInterface *iface,
+            bool streaming, unsigned long spillThreshold, bool mergeEvents);
   virtual ~ABWParser();
   bool parse();
+  //! the sharing of the property lists and the event log of the last parse
+  void getStatistics(AbiDocumentStatistics &statistics) const;
 
 private:
   ABWParser();
@@ -41,17 +53,18 @@ private:
 
   bool processXmlDocument(librevenge::RVNGInputStream *input);
   int processXmlNode(xmlTextReaderPtr reader);
+  int skipElement(xmlTextReaderPtr reader);
+  bool replayEvents(const ABWEventLog &events);
+  ABWCollector *createContentCollector(bool isDocument);
 
   void readAbiword(xmlTextReaderPtr reader);
   void readM(xmlTextReaderPtr reader);
-  int readHistory(xmlTextReaderPtr reader);
-  int readRevisions(xmlTextReaderPtr reader);
-  int readIgnoredWords(xmlTextReaderPtr reader);
   void readPageSize(xmlTextReaderPtr reader);
   void readSection(xmlTextReaderPtr reader);
   void readA(xmlTextReaderPtr reader);
   void readC(xmlTextReaderPtr reader);
   int readD(xmlTextReaderPtr reader);
+  bool findDataOffset(xmlTextReaderPtr reader, const xmlChar *text, unsigned long &offset);
   void readL(xmlTextReaderPtr reader);
   void readP(xmlTextReaderPtr reader);
   void readS(xmlTextReaderPtr reader);
@@ -64,10 +77,17 @@ private:
   void readCell(xmlTextReaderPtr reader);
 
   void readFrame(xmlTextReaderPtr reader);
+  void openFrame(const char *props, const char *imageId, const char *title, const char *alt);
   void readCloseFrame();
 
   librevenge::RVNGInputStream *m_input;
   librevenge::RVNGTextInterface *m_iface;
+  bool m_streaming;
+  unsigned long m_spillThreshold;
+  bool m_mergeEvents;
+  unsigned long m_loggedEvents;
+  unsigned long m_loggedBytes;
+  bool m_eventLogTruncated;
   std::unique_ptr<ABWCollector> m_collector;
   std::unique_ptr<ABWParserState> m_state;
 };
@@ -0,0 +1,186 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libabw project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <cassert>
+#include <string.h>
+
+#include "ABWPropertyMap.h"
+#include "ABWCollector.h"
+
+namespace
+{
+
+#include "prophash.h"
+
+static_assert(PROP_COUNT < 256, "property positions must fit in m_index");
+
+} // anonymous namespace
+
+libabw::ABWPropertyMap::Value::Value(const int id) :
+  m_id(id),
+  m_string(),
+  m_intState(NOT_DECODED),
+  m_int(0),
+  m_doubleState(NOT_DECODED),
+  m_double(0.0),
+  m_unit(ABW_NONE)
+{
+}
+
+libabw::ABWPropertyMap::ABWPropertyMap() :
+  m_values(),
+  m_index(),
+  m_overflow()
+{
+}
+
+int libabw::ABWPropertyMap::getPropertyId(const char *name, unsigned length)
+{
+  const proptoken *prop = Perfect_Hash::in_word_set(name, length);
+  if (prop)
+    return prop->propId;
+  else
+    return PROP_INVALID;
+}
+
+bool libabw::ABWPropertyMap::empty() const
+{
+  return m_values.empty() && m_overflow.empty();
+}
+
+void libabw::ABWPropertyMap::clear()
+{
+  for (const auto &value : m_values)
+    m_index[value.m_id - 1] = 0;
+  m_values.clear();
+  m_overflow.clear();
+}
+
+const std::string *libabw::ABWPropertyMap::find(const int id) const
+{
+  const Value *const value = _findValue(id);
+  return value ? &value->m_string : nullptr;
+}
+
+const std::string *libabw::ABWPropertyMap::find(const std::string &name) const
+{
+  const int id = getPropertyId(name.c_str(), unsigned(name.size()));
+  if (id != PROP_INVALID)
+    return find(id);
+  const auto it = m_overflow.find(name);
+  if (it != m_overflow.end())
+    return &it->second;
+  return nullptr;
+}
+
+bool libabw::ABWPropertyMap::findInt(const int id, int &value) const
+{
+  const Value *const prop = _findValue(id);
+  if (!prop)
+    return false;
+  if (prop->m_intState == NOT_DECODED)
+    _decodeInt(*prop);
+  if (prop->m_intState != DECODED)
+    return false;
+  value = prop->m_int;
+  return true;
+}
+
+bool libabw::ABWPropertyMap::findDouble(const int id, double &value, ABWUnit &unit) const
+{
+  const Value *const prop = _findValue(id);
+  if (!prop)
+    return false;
+  if (prop->m_doubleState == NOT_DECODED)
+    _decodeDouble(*prop);
+  if (prop->m_doubleState != DECODED)
+    return false;
+  value = prop->m_double;
+  unit = prop->m_unit;
+  return true;
+}
+
+void libabw::ABWPropertyMap::set(const int id, const std::string &value)
+{
+  if (id <= 0 || id > PROP_COUNT)
+    return;
+  _insert(id).m_string = value;
+}
+
+void libabw::ABWPropertyMap::set(const std::string &name, const std::string &value)
+{
+  set(name.c_str(), unsigned(name.size()), value.c_str(), unsigned(value.size()));
+}
+
+void libabw::ABWPropertyMap::set(const char *const name, const unsigned nameLength, const char *const value, const unsigned valueLength)
+{
+  const proptoken *const prop = Perfect_Hash::in_word_set(name, nameLength);
+  if (!prop)
+  {
+    m_overflow[std::string(name, nameLength)].assign(value, valueLength);
+    return;
+  }
+
+  Value &newValue = _insert(prop->propId);
+  newValue.m_string.assign(value, valueLength);
+  switch (prop->propType)
+  {
+  case PROP_TYPE_INT:
+    _decodeInt(newValue);
+    break;
+  case PROP_TYPE_LENGTH:
+    _decodeDouble(newValue);
+    break;
+  default:
+    break;
+  }
+}
+
+void libabw::ABWPropertyMap::merge(const ABWPropertyMap &props)
+{
+  for (const auto &value : props.m_values)
+    _insert(value.m_id) = value;
+  for (const auto &value : props.m_overflow)
+    m_overflow[value.first] = value.second;
+}
+
+libabw::ABWPropertyMap::Value &libabw::ABWPropertyMap::_insert(const int id)
+{
+  assert(id > 0 && id <= PROP_COUNT);
+  unsigned char &pos = m_index[id - 1];
+  if (pos)
+  {
+    Value &value = m_values[pos - 1];
+    value.m_intState = NOT_DECODED;
+    value.m_doubleState = NOT_DECODED;
+    return value;
+  }
+  m_values.push_back(Value(id));
+  pos = static_cast<unsigned char>(m_values.size());
+  return m_values.back();
+}
+
+const libabw::ABWPropertyMap::Value *libabw::ABWPropertyMap::_findValue(const int id) const
+{
+  if (id <= 0 || id > PROP_COUNT || !m_index[id - 1])
+    return nullptr;
+  return &m_values[m_index[id - 1] - 1];
+}
+
+void libabw::ABWPropertyMap::_decodeInt(const Value &value)
+{
+  value.m_intState = libabw::findInt(value.m_string, value.m_int) ? DECODED : NOT_VALID;
+}
+
+void libabw::ABWPropertyMap::_decodeDouble(const Value &value)
+{
+  value.m_doubleState = libabw::findDouble(value.m_string, value.m_double, value.m_unit) ? DECODED : NOT_VALID;
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,107 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libabw project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef __ABWPROPERTYMAP_H__
+#define __ABWPROPERTYMAP_H__
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "props.h"
+
+namespace libabw
+{
+
+enum ABWUnit
+{
+  ABW_NONE,
+  ABW_CM,
+  ABW_IN,
+  ABW_MM,
+  ABW_PI,
+  ABW_PT,
+  ABW_PX,
+  ABW_PERCENT
+};
+
+/* The properties of an element, as parsed from its props attribute.
+
+   The properties listed in props.txt are kept in a flat table indexed by
+   their id, so looking them up neither allocates nor compares strings.
+   Any other properties go to an ordinary map, by name.
+
+   Properties that props.txt gives a type are decoded when they are set,
+   and any property is decoded at most once as a number or a length, so
+   the values of styles copied around with merge() are only parsed once.
+ */
+class ABWPropertyMap
+{
+public:
+  ABWPropertyMap();
+
+  // returns PROP_INVALID if the name is not a known property
+  static int getPropertyId(const char *name, unsigned length);
+
+  bool empty() const;
+  void clear();
+
+  // returns 0 if the property is not set
+  const std::string *find(int id) const;
+  const std::string *find(const std::string &name) const;
+
+  // return false if the property is not set or is not an integer, resp. a length
+  bool findInt(int id, int &value) const;
+  bool findDouble(int id, double &value, ABWUnit &unit) const;
+
+  // does nothing if id is not the id of a known property
+  void set(int id, const std::string &value);
+  void set(const std::string &name, const std::string &value);
+  void set(const char *name, unsigned nameLength, const char *value, unsigned valueLength);
+
+  // sets all the properties of props, replacing the values set already
+  void merge(const ABWPropertyMap &props);
+
+private:
+  enum DecodeState
+  {
+    NOT_DECODED,
+    DECODED,
+    NOT_VALID
+  };
+
+  struct Value
+  {
+    explicit Value(int id);
+
+    int m_id;
+    std::string m_string;
+    mutable DecodeState m_intState;
+    mutable int m_int;
+    mutable DecodeState m_doubleState;
+    mutable double m_double;
+    mutable ABWUnit m_unit;
+  };
+
+  Value &_insert(int id);
+  const Value *_findValue(int id) const;
+  static void _decodeInt(const Value &value);
+  static void _decodeDouble(const Value &value);
+
+  std::vector<Value> m_values;
+  // 1 + the position of the property in m_values, or 0 if it is not set
+  unsigned char m_index[PROP_COUNT];
+  std::map<std::string, std::string> m_overflow;
+};
+
+} // namespace libabw
+
+#endif /* __ABWPROPERTYMAP_H__ */
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,258 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libabw project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "ABWSinglePassCollector.h"
+#include "ABWContentCollector.h"
+#include "ABWStylesCollector.h"
+
+libabw::ABWSinglePassCollector::ABWSinglePassCollector(ABWStylesCollector &stylesCollector, ABWContentCollector *contentCollector) :
+  m_stylesCollector(stylesCollector),
+  m_contentCollector(contentCollector)
+{
+}
+
+libabw::ABWSinglePassCollector::~ABWSinglePassCollector()
+{
+}
+
+void libabw::ABWSinglePassCollector::collectTextStyle(const char *name, const char *basedon, const char *followedby, const char *props)
+{
+  m_stylesCollector.collectTextStyle(name, basedon, followedby, props);
+  m_contentCollector->collectTextStyle(name, basedon, followedby, props);
+}
+
+void libabw::ABWSinglePassCollector::collectDocumentProperties(const char *props)
+{
+  m_stylesCollector.collectDocumentProperties(props);
+  m_contentCollector->collectDocumentProperties(props);
+}
+
+void libabw::ABWSinglePassCollector::collectParagraphProperties(const char *level, const char *listid, const char *parentid,
+                                                                const char *style, const char *props)
+{
+  m_stylesCollector.collectParagraphProperties(level, listid, parentid, style, props);
+  m_contentCollector->collectParagraphProperties(level, listid, parentid, style, props);
+}
+
+void libabw::ABWSinglePassCollector::collectSectionProperties(const char *footer, const char *footerLeft, const char *footerFirst,
+                                                              const char *footerLast, const char *header, const char *headerLeft,
+                                                              const char *headerFirst, const char *headerLast, const char *props)
+{
+  m_stylesCollector.collectSectionProperties(footer, footerLeft, footerFirst, footerLast,
+                                             header, headerLeft, headerFirst, headerLast, props);
+  m_contentCollector->collectSectionProperties(footer, footerLeft, footerFirst, footerLast,
+                                               header, headerLeft, headerFirst, headerLast, props);
+}
+
+void libabw::ABWSinglePassCollector::collectCharacterProperties(const char *style, const char *props)
+{
+  m_stylesCollector.collectCharacterProperties(style, props);
+  m_contentCollector->collectCharacterProperties(style, props);
+}
+
+void libabw::ABWSinglePassCollector::collectPageSize(const char *width, const char *height, const char *units, const char *pageScale)
+{
+  m_stylesCollector.collectPageSize(width, height, units, pageScale);
+  m_contentCollector->collectPageSize(width, height, units, pageScale);
+}
+
+void libabw::ABWSinglePassCollector::closeParagraphOrListElement()
+{
+  m_stylesCollector.closeParagraphOrListElement();
+  m_contentCollector->closeParagraphOrListElement();
+}
+
+void libabw::ABWSinglePassCollector::closeSpan()
+{
+  m_stylesCollector.closeSpan();
+  m_contentCollector->closeSpan();
+}
+
+void libabw::ABWSinglePassCollector::openLink(const char *href)
+{
+  m_stylesCollector.openLink(href);
+  m_contentCollector->openLink(href);
+}
+
+void libabw::ABWSinglePassCollector::closeLink()
+{
+  m_stylesCollector.closeLink();
+  m_contentCollector->closeLink();
+}
+
+void libabw::ABWSinglePassCollector::openFoot(const char *id)
+{
+  m_stylesCollector.openFoot(id);
+  m_contentCollector->openFoot(id);
+}
+
+void libabw::ABWSinglePassCollector::closeFoot()
+{
+  m_stylesCollector.closeFoot();
+  m_contentCollector->closeFoot();
+}
+
+void libabw::ABWSinglePassCollector::openEndnote(const char *id)
+{
+  m_stylesCollector.openEndnote(id);
+  m_contentCollector->openEndnote(id);
+}
+
+void libabw::ABWSinglePassCollector::closeEndnote()
+{
+  m_stylesCollector.closeEndnote();
+  m_contentCollector->closeEndnote();
+}
+
+void libabw::ABWSinglePassCollector::openField(const char *type, const char *id)
+{
+  m_stylesCollector.openField(type, id);
+  m_contentCollector->openField(type, id);
+}
+
+void libabw::ABWSinglePassCollector::closeField()
+{
+  m_stylesCollector.closeField();
+  m_contentCollector->closeField();
+}
+
+void libabw::ABWSinglePassCollector::endSection()
+{
+  m_stylesCollector.endSection();
+  m_contentCollector->endSection();
+}
+
+void libabw::ABWSinglePassCollector::startDocument()
+{
+  m_stylesCollector.startDocument();
+  m_contentCollector->startDocument();
+}
+
+void libabw::ABWSinglePassCollector::endDocument()
+{
+  m_stylesCollector.endDocument();
+  // the parser starts again with two passes in this case, so nothing must be written
+  if (!m_stylesCollector.listsChangedAfterUse())
+    m_contentCollector->endDocument();
+}
+
+void libabw::ABWSinglePassCollector::insertLineBreak()
+{
+  m_stylesCollector.insertLineBreak();
+  m_contentCollector->insertLineBreak();
+}
+
+void libabw::ABWSinglePassCollector::insertColumnBreak()
+{
+  m_stylesCollector.insertColumnBreak();
+  m_contentCollector->insertColumnBreak();
+}
+
+void libabw::ABWSinglePassCollector::insertPageBreak()
+{
+  m_stylesCollector.insertPageBreak();
+  m_contentCollector->insertPageBreak();
+}
+
+void libabw::ABWSinglePassCollector::insertText(const char *text)
+{
+  m_stylesCollector.insertText(text);
+  m_contentCollector->insertText(text);
+}
+
+void libabw::ABWSinglePassCollector::insertImage(const char *dataid, const char *props)
+{
+  m_stylesCollector.insertImage(dataid, props);
+  m_contentCollector->insertImage(dataid, props);
+}
+
+void libabw::ABWSinglePassCollector::collectList(const char *id, const char *listDecimal, const char *listDelim,
+                                                 const char *parentid, const char *startValue, const char *type)
+{
+  m_stylesCollector.collectList(id, listDecimal, listDelim, parentid, startValue, type);
+  m_contentCollector->collectList(id, listDecimal, listDelim, parentid, startValue, type);
+}
+
+void libabw::ABWSinglePassCollector::collectData(const char *name, const char *mimeType, const librevenge::RVNGBinaryData &data)
+{
+  m_stylesCollector.collectData(name, mimeType, data);
+  m_contentCollector->collectData(name, mimeType, data);
+}
+
+bool libabw::ABWSinglePassCollector::isDataCollected() const
+{
+  return m_stylesCollector.isDataCollected() || m_contentCollector->isDataCollected();
+}
+
+void libabw::ABWSinglePassCollector::collectHeaderFooter(const char *id, const char *type)
+{
+  m_stylesCollector.collectHeaderFooter(id, type);
+  m_contentCollector->collectHeaderFooter(id, type);
+}
+
+void libabw::ABWSinglePassCollector::openTable(const char *props)
+{
+  m_stylesCollector.openTable(props);
+  m_contentCollector->openTable(props);
+}
+
+void libabw::ABWSinglePassCollector::closeTable()
+{
+  m_stylesCollector.closeTable();
+  m_contentCollector->closeTable();
+}
+
+void libabw::ABWSinglePassCollector::openCell(const char *props)
+{
+  m_stylesCollector.openCell(props);
+  m_contentCollector->openCell(props);
+}
+
+void libabw::ABWSinglePassCollector::closeCell()
+{
+  m_stylesCollector.closeCell();
+  m_contentCollector->closeCell();
+}
+
+void libabw::ABWSinglePassCollector::openFrame(const char *props, const char *imageId, const char *title, const char *alt)
+{
+  m_stylesCollector.openFrame(props, imageId, title, alt);
+  m_contentCollector->openFrame(props, imageId, title, alt);
+}
+
+void libabw::ABWSinglePassCollector::closeFrame(ABWOutputElements *(&elements), bool &pageFrame)
+{
+  m_stylesCollector.closeFrame(elements, pageFrame);
+  m_contentCollector->closeFrame(elements, pageFrame);
+}
+
+void libabw::ABWSinglePassCollector::addFrameElements(ABWOutputElements &elements, bool pageFrame)
+{
+  m_stylesCollector.addFrameElements(elements, pageFrame);
+  m_contentCollector->addFrameElements(elements, pageFrame);
+}
+
+void libabw::ABWSinglePassCollector::addMetadataEntry(const char *name, const char *value)
+{
+  m_stylesCollector.addMetadataEntry(name, value);
+  m_contentCollector->addMetadataEntry(name, value);
+}
+
+bool libabw::ABWSinglePassCollector::reset()
+{
+  // the styles collector is shared by the whole document, it is not reset
+  return m_contentCollector->reset();
+}
+
+bool libabw::ABWSinglePassCollector::isOutputComplete() const
+{
+  return m_contentCollector->isOutputComplete();
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
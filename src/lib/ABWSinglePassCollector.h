@@ -0,0 +1,97 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libabw project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef __ABWSINGLEPASSCOLLECTOR_H__
+#define __ABWSINGLEPASSCOLLECTOR_H__
+
+#include <memory>
+#include <librevenge/librevenge.h>
+#include "ABWCollector.h"
+
+namespace libabw
+{
+
+class ABWContentCollector;
+class ABWStylesCollector;
+
+/** Collector used to parse a document in one pass: every event is sent
+    to the styles collector first, then to the content collector.
+
+    The content collector leaves the data which are only complete at the
+    end of the document (table sizes, images, list properties) to be
+    resolved when its output is written.
+  */
+class ABWSinglePassCollector : public ABWCollector
+{
+public:
+  ABWSinglePassCollector(ABWStylesCollector &stylesCollector, ABWContentCollector *contentCollector);
+  ~ABWSinglePassCollector() override;
+
+  // collector functions
+
+  void collectTextStyle(const char *name, const char *basedon, const char *followedby, const char *props) override;
+  void collectDocumentProperties(const char *props) override;
+  void collectParagraphProperties(const char *level, const char *listid, const char *parentid,
+                                  const char *style, const char *props) override;
+  void collectSectionProperties(const char *footer, const char *footerLeft, const char *footerFirst,
+                                const char *footerLast, const char *header, const char *headerLeft,
+                                const char *headerFirst, const char *headerLast, const char *props) override;
+  void collectCharacterProperties(const char *style, const char *props) override;
+  void collectPageSize(const char *width, const char *height, const char *units, const char *pageScale) override;
+  void closeParagraphOrListElement() override;
+  void closeSpan() override;
+  void openLink(const char *href) override;
+  void closeLink() override;
+  void openFoot(const char *id) override;
+  void closeFoot() override;
+  void openEndnote(const char *id) override;
+  void closeEndnote() override;
+  void openField(const char *type, const char *id) override;
+  void closeField() override;
+  void endSection() override;
+  void startDocument() override;
+  void endDocument() override;
+  void insertLineBreak() override;
+  void insertColumnBreak() override;
+  void insertPageBreak() override;
+  void insertText(const char *text) override;
+  void insertImage(const char *dataid, const char *props) override;
+  void collectList(const char *id, const char *listDecimal, const char *listDelim,
+                   const char *parentid, const char *startValue, const char *type) override;
+
+  void collectData(const char *name, const char *mimeType, const librevenge::RVNGBinaryData &data) override;
+  bool isDataCollected() const override;
+  void collectHeaderFooter(const char *id, const char *type) override;
+
+  void openTable(const char *props) override;
+  void closeTable() override;
+  void openCell(const char *props) override;
+  void closeCell() override;
+
+  void openFrame(const char *props, const char *imageId, const char *title, const char *alt) override;
+  void closeFrame(ABWOutputElements *(&elements), bool &pageFrame) override;
+  void addFrameElements(ABWOutputElements &elements, bool pageFrame) override;
+
+  void addMetadataEntry(const char *name, const char *value) override;
+
+  bool reset() override;
+  bool isOutputComplete() const override;
+
+private:
+  ABWSinglePassCollector(const ABWSinglePassCollector &);
+  ABWSinglePassCollector &operator=(const ABWSinglePassCollector &);
+
+  ABWStylesCollector &m_stylesCollector;
+  std::unique_ptr<ABWContentCollector> m_contentCollector;
+};
+
+} // namespace libabw
+
+#endif /* __ABWSINGLEPASSCOLLECTOR_H__ */
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -8,6 +8,7 @@
  */
 
 #include <limits>
+#include <set>
 #include <vector>
 
 #include <boost/algorithm/string.hpp>
@@ -109,6 +110,52 @@ static void appendUCS4(librevenge::RVNGString &str, unsigned ucs4)
   str.append(utf8.data());
 }
 
+/** try to find the parent's level corresponding to a level with some id
+    and use its original id to define the list id.
+
+    Seen corresponds to the list of level that we have already examined,
+    it is used to check also for loop; brokenLoop is set if a parent link
+    had to be removed
+  */
+static int _findAndUpdateListElementId(std::map<int, std::shared_ptr<ABWListElement>> &listElements, int id, std::set<int> &seen,
+                                       bool &brokenLoop)
+{
+  if (listElements.find(id)==listElements.end() || !listElements.find(id)->second)
+    return 0;
+  const std::shared_ptr<ABWListElement> &tmpElement= listElements.find(id)->second;
+  if (tmpElement->m_listId)
+    return tmpElement->m_listId;
+  if (seen.find(id)!=seen.end())
+  {
+    // oops, this means that we have a loop
+    if (tmpElement->m_parentId)
+      brokenLoop = true;
+    tmpElement->m_parentId=0;
+  }
+  else
+    seen.insert(id);
+  if (!tmpElement->m_parentId)
+  {
+    tmpElement->m_listId=id;
+    return id;
+  }
+  tmpElement->m_listId=_findAndUpdateListElementId(listElements, tmpElement->m_parentId, seen, brokenLoop);
+  return tmpElement->m_listId;
+}
+
+/** try to update the final list id for each list elements, returns false if some parent link was broken */
+static bool updateListElementIds(std::map<int, std::shared_ptr<ABWListElement>> &listElements)
+{
+  std::set<int> seens;
+  bool brokenLoop = false;
+  for (const auto &elem : listElements)
+  {
+    if (!elem.second) continue;
+    _findAndUpdateListElementId(listElements, elem.first, seens, brokenLoop);
+  }
+  return !brokenLoop;
+}
+
 } // anonymous namespace
 
 } // namespace libabw
@@ -136,18 +183,38 @@ libabw::ABWStylesParsingState::ABWStylesParsingState(const ABWStylesParsingState
 libabw::ABWStylesParsingState::~ABWStylesParsingState() {}
 
 libabw::ABWStylesCollector::ABWStylesCollector(std::map<int, int> &tableSizes,
-                                               std::map<std::string, ABWData> &data,
+                                               ABWDataMap &data,
                                                std::map<int, std::shared_ptr<ABWListElement>> &listElements) :
   m_ps(new ABWStylesParsingState),
   m_tableSizes(tableSizes),
   m_data(data),
   m_tableCounter(0),
-  m_listElements(listElements) {}
+  m_listElements(listElements),
+  m_isParagraphCollected(false),
+  m_listsChangedAfterUse(false) {}
 
 libabw::ABWStylesCollector::~ABWStylesCollector()
 {
 }
 
+void libabw::ABWStylesCollector::endDocument()
+{
+  if (!updateListElementIds(m_listElements) && m_isParagraphCollected)
+    m_listsChangedAfterUse = true;
+}
+
+bool libabw::ABWStylesCollector::_isListParent(int id) const
+{
+  if (!id) // 0 means no parent
+    return false;
+  for (const auto &elem : m_listElements)
+  {
+    if (elem.second && elem.second->m_parentId == id)
+      return true;
+  }
+  return false;
+}
+
 void libabw::ABWStylesCollector::openTable(const char *)
 {
   m_ps->m_tableStates.push(ABWStylesTableState());
@@ -173,7 +240,7 @@ void libabw::ABWStylesCollector::openCell(const char *props)
     if (props)
       parsePropString(props, m_ps->m_tableStates.top().m_currentCellProperties);
     int currentRow(0);
-    if (!findInt(_findCellProperty("top-attach"), currentRow))
+    if (!m_ps->m_tableStates.top().m_currentCellProperties.findInt(PROP_TOP_ATTACH, currentRow))
     {
       currentRow = m_ps->m_tableStates.top().m_currentTableRow;
       if (currentRow < std::numeric_limits<int>::max())
@@ -186,8 +253,8 @@ void libabw::ABWStylesCollector::openCell(const char *props)
     {
       int leftAttach(0);
       int rightAttach(0);
-      if (findInt(_findCellProperty("left-attach"), leftAttach)
-          && findInt(_findCellProperty("right-attach"), rightAttach)
+      if (m_ps->m_tableStates.top().m_currentCellProperties.findInt(PROP_LEFT_ATTACH, leftAttach)
+          && m_ps->m_tableStates.top().m_currentCellProperties.findInt(PROP_RIGHT_ATTACH, rightAttach)
           && leftAttach >= 0
           && rightAttach > leftAttach
           && rightAttach - leftAttach < std::numeric_limits<int>::max() - m_ps->m_tableStates.top().m_currentTableWidth
@@ -205,19 +272,11 @@ void libabw::ABWStylesCollector::closeCell()
     m_ps->m_tableStates.top().m_currentCellProperties.clear();
 }
 
-std::string libabw::ABWStylesCollector::_findCellProperty(const char *name)
-{
-  ABWPropertyMap::const_iterator iter = m_ps->m_tableStates.top().m_currentCellProperties.find(name);
-  if (iter != m_ps->m_tableStates.top().m_currentCellProperties.end())
-    return iter->second;
-  return std::string();
-}
-
 void libabw::ABWStylesCollector::collectData(const char *name, const char *mimeType, const librevenge::RVNGBinaryData &data)
 {
   if (!name)
     return;
-  m_data[name] = ABWData(mimeType ? mimeType : "", data);
+  m_data.insert(name, ABWData(mimeType ? mimeType : "", data));
 }
 
 void libabw::ABWStylesCollector::_processList(int id, const char *listDelim, int parentid, int startValue, int type)
@@ -318,7 +377,8 @@ void libabw::ABWStylesCollector::_processList(int id, const char *listDelim, int
     }
     m_listElements[id] = tmpElement;
   }
-  if (parentid)
+  // a list being its own parent would be considered a loop later anyway
+  if (parentid && parentid != id)
     m_listElements[id]->m_parentId = parentid;
 }
 
@@ -330,6 +390,8 @@ void libabw::ABWStylesCollector::collectList(const char *id, const char *, const
     intId = 0;
   if (!intId)
     return;
+  if (m_isParagraphCollected && (m_listElements[intId] || _isListParent(intId)))
+    m_listsChangedAfterUse = true;
   if (m_listElements[intId])
     m_listElements[intId].reset();
   int intType(0);
@@ -360,58 +422,60 @@ void libabw::ABWStylesCollector::collectParagraphProperties(const char *level, c
   auto iter = m_listElements.find(intListId);
   if (iter == m_listElements.end() || !iter->second)
   {
-    ABWPropertyMap::const_iterator i = properties.find("list-style");
+    const std::string *prop = properties.find(PROP_LIST_STYLE);
     int listStyle(NOT_A_LIST);
-    if (i != properties.end())
+    if (prop)
     {
-      if (i->second == "Numbered List")
+      if (*prop == "Numbered List")
         listStyle = NUMBERED_LIST;
-      else if (i->second == "Lower Case List")
+      else if (*prop == "Lower Case List")
         listStyle = LOWERCASE_LIST;
-      else if (i->second == "Upper Case List")
+      else if (*prop == "Upper Case List")
         listStyle = UPPERCASE_LIST;
-      else if (i->second == "Lower Roman List")
+      else if (*prop == "Lower Roman List")
         listStyle = LOWERROMAN_LIST;
-      else if (i->second == "Upper Roman List")
+      else if (*prop == "Upper Roman List")
         listStyle = UPPERROMAN_LIST;
-      else if (i->second == "Hebrew List")
+      else if (*prop == "Hebrew List")
         listStyle = HEBREW_LIST;
-      else if (i->second == "Arabic List")
+      else if (*prop == "Arabic List")
         listStyle = ARABICNUMBERED_LIST;
-      else if (i->second == "Bullet List")
+      else if (*prop == "Bullet List")
         listStyle = BULLETED_LIST;
-      else if (i->second == "Dashed List")
+      else if (*prop == "Dashed List")
         listStyle = DASHED_LIST;
-      else if (i->second == "Square List")
+      else if (*prop == "Square List")
         listStyle = SQUARE_LIST;
-      else if (i->second == "Triangle List")
+      else if (*prop == "Triangle List")
         listStyle = TRIANGLE_LIST;
-      else if (i->second == "Diamond List")
+      else if (*prop == "Diamond List")
         listStyle = DIAMOND_LIST;
-      else if (i->second == "Star List")
+      else if (*prop == "Star List")
         listStyle = STAR_LIST;
-      else if (i->second == "Implies List")
+      else if (*prop == "Implies List")
         listStyle = IMPLIES_LIST;
-      else if (i->second == "Tick List")
+      else if (*prop == "Tick List")
         listStyle = TICK_LIST;
-      else if (i->second == "Box List")
+      else if (*prop == "Box List")
         listStyle = BOX_LIST;
-      else if (i->second == "Hand List")
+      else if (*prop == "Hand List")
         listStyle = HAND_LIST;
-      else if (i->second == "Heart List")
+      else if (*prop == "Heart List")
         listStyle = HEART_LIST;
-      else if (i->second == "Arrowhead List")
+      else if (*prop == "Arrowhead List")
         listStyle = ARROWHEAD_LIST;
       else
         listStyle = NOT_A_LIST;
     }
-    i = properties.find("start-value");
+    prop = properties.find(PROP_START_VALUE);
     std::string startValue;
-    if (i != properties.end())
-      startValue = i->second;
+    if (prop)
+      startValue = *prop;
     int intStartValue(0);
     if (startValue.empty() || findInt(startValue, intStartValue) || intStartValue < 0)
       intStartValue = 0;
+    if (m_isParagraphCollected && _isListParent(intListId))
+      m_listsChangedAfterUse = true;
     _processList(intListId, "%L", intParentId, intStartValue, listStyle);
     iter = m_listElements.find(intListId);
   }
@@ -422,18 +486,17 @@ void libabw::ABWStylesCollector::collectParagraphProperties(const char *level, c
     if (!level || !findInt(level, listElement->m_listLevel) || listElement->m_listLevel < 0)
       listElement->m_listLevel = 0;
 
-    ABWPropertyMap::const_iterator i = properties.find("margin-left");
     ABWUnit unit(ABW_NONE);
     double marginLeft(0.0);
-    if (i == properties.end() || !findDouble(i->second, marginLeft, unit) || unit != ABW_IN)
+    if (!properties.findDouble(PROP_MARGIN_LEFT, marginLeft, unit) || unit != ABW_IN)
       marginLeft = 0.0;
-    i = properties.find("text-indent");
     double textIndent(0.0);
-    if (i == properties.end() || !findDouble(i->second, textIndent, unit) || unit != ABW_IN)
+    if (!properties.findDouble(PROP_TEXT_INDENT, textIndent, unit) || unit != ABW_IN)
       textIndent = 0.0;
     listElement->m_minLabelWidth = -textIndent;
     listElement->m_spaceBefore = marginLeft + textIndent;
   }
+  m_isParagraphCollected = true;
 }
 
 /* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -44,7 +44,7 @@ class ABWStylesCollector : public ABWCollector
 {
 public:
   ABWStylesCollector(std::map<int, int> &tableSizes,
-                     std::map<std::string, ABWData> &data,
+                     ABWDataMap &data,
                      std::map<int, std::shared_ptr<ABWListElement>> &listElements);
   ~ABWStylesCollector() override;
 
@@ -71,7 +71,7 @@ public:
   void closeField() override {}
   void endSection() override {}
   void startDocument() override {}
-  void endDocument() override {}
+  void endDocument() override;
   void insertLineBreak() override {}
   void insertColumnBreak() override {}
   void insertPageBreak() override {}
@@ -79,6 +79,10 @@ public:
   void insertImage(const char *, const char *) override {}
 
   void collectData(const char *name, const char *mimeType, const librevenge::RVNGBinaryData &data) override;
+  bool isDataCollected() const override
+  {
+    return true;
+  }
   void collectHeaderFooter(const char *, const char *) override {}
   void collectList(const char *id, const char *listDecimal, const char *listDelim,
                    const char *parentid, const char *startValue, const char *type) override;
@@ -97,18 +101,28 @@ public:
 
   void addMetadataEntry(const char *, const char *) override {}
 
+  /** Whether the list structure (the elements, their types and parents) was
+      modified after a paragraph could have used it. The content collected in
+      the same pass can then differ from a second pass over the document. */
+  bool listsChangedAfterUse() const
+  {
+    return m_listsChangedAfterUse;
+  }
+
 private:
   ABWStylesCollector(const ABWStylesCollector &);
   ABWStylesCollector &operator=(const ABWStylesCollector &);
 
-  std::string _findCellProperty(const char *name);
   void _processList(int id, const char *listDelim, int parentid, int startValue, int type);
+  bool _isListParent(int id) const;
 
   std::unique_ptr<ABWStylesParsingState> m_ps;
   std::map<int, int> &m_tableSizes;
-  std::map<std::string, ABWData> &m_data;
+  ABWDataMap &m_data;
   int m_tableCounter;
   std::map<int, std::shared_ptr<ABWListElement>> &m_listElements;
+  bool m_isParagraphCollected;
+  bool m_listsChangedAfterUse;
 };
 
 } // namespace libabw
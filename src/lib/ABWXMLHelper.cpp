@@ -7,11 +7,14 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/.
  */
 
+#include <limits.h>
 #include <string.h>
 #include <libxml/xmlIO.h>
 #include <libxml/xmlmemory.h>
 #include <librevenge-stream/librevenge-stream.h>
+#include "ABWMappedFileStream.h"
 #include "ABWXMLHelper.h"
+#include "ABWZlibStream.h"
 #include "libabw_internal.h"
 
 namespace libabw
@@ -45,6 +48,16 @@ extern "C" {
     return int(tmpNumBytesRead);
   }
 
+  static int abwxmlZlibInputReadFunc(void *context, char *buffer, int len)
+  {
+    auto *input = (ABWZlibStream *)context;
+
+    if ((!input) || (!buffer) || (len < 0))
+      return -1;
+
+    return int(input->readTo(reinterpret_cast<unsigned char *>(buffer), (unsigned long) len));
+  }
+
 #ifdef DEBUG
   static void abwxmlReaderErrorFunc(void *arg, const char *message, xmlParserSeverities severity, xmlTextReaderLocatorPtr)
 #else
@@ -75,6 +88,46 @@ extern "C" {
 
 } // extern "C"
 
+/* Whether the stream keeps all its data in memory, so that reading the
+   rest of it at once does not copy it. Other streams are read in small
+   blocks, as they might have to allocate a buffer for the whole read.
+ */
+bool isInMemory(librevenge::RVNGInputStream *input)
+{
+  auto *const zlibStream = dynamic_cast<ABWZlibStream *>(input);
+  if (zlibStream)
+    input = zlibStream->getUncompressedInput();
+  return dynamic_cast<ABWMappedFileStream *>(input) || dynamic_cast<librevenge::RVNGStringStream *>(input);
+}
+
+/* Gets the rest of the stream in one read, so it can be parsed in place.
+ */
+bool getRemainingData(librevenge::RVNGInputStream *input, const unsigned char *&data, unsigned long &size)
+{
+  const long start = input->tell();
+  if (start < 0)
+    return false;
+  if (input->seek(0, librevenge::RVNG_SEEK_END))
+  {
+    input->seek(start, librevenge::RVNG_SEEK_SET);
+    return false;
+  }
+  const long end = input->tell();
+  input->seek(start, librevenge::RVNG_SEEK_SET);
+  if (end <= start || end - start > INT_MAX)
+    return false;
+
+  unsigned long numBytesRead = 0;
+  data = input->read((unsigned long)(end - start), numBytesRead);
+  if (!data || numBytesRead != (unsigned long)(end - start))
+  {
+    input->seek(start, librevenge::RVNG_SEEK_SET);
+    return false;
+  }
+  size = numBytesRead;
+  return true;
+}
+
 } // anonymous namespace
 
 ABWXMLString::ABWXMLString(xmlChar *xml)
@@ -128,12 +181,32 @@ void ABWXMLProgressWatcher::signalError()
 
 // xmlTextReader helper function
 
-std::unique_ptr<xmlTextReader, void(*)(xmlTextReaderPtr)> xmlReaderForStream(librevenge::RVNGInputStream *input, ABWXMLProgressWatcher *watcher)
+std::unique_ptr<xmlTextReader, void(*)(xmlTextReaderPtr)> xmlReaderForStream(librevenge::RVNGInputStream *input, ABWXMLProgressWatcher *watcher,
+                                                                             const unsigned char **inPlaceData, unsigned long *inPlaceSize)
 {
-  std::unique_ptr<xmlTextReader, void(*)(xmlTextReaderPtr)> reader(
-    xmlReaderForIO(abwxmlInputReadFunc, abwxmlInputCloseFunc, (void *)input, nullptr, nullptr,
-                   XML_PARSE_NOBLANKS|XML_PARSE_NONET|XML_PARSE_RECOVER),
-    xmlFreeTextReader);
+  const int options = XML_PARSE_NOBLANKS|XML_PARSE_NONET|XML_PARSE_RECOVER;
+  xmlTextReaderPtr xmlReader = nullptr;
+  auto *const zlibStream = dynamic_cast<ABWZlibStream *>(input);
+  const unsigned char *data = nullptr;
+  unsigned long size = 0;
+  if (zlibStream && zlibStream->isCompressed())
+    // inflate straight into the parser's input buffer
+    xmlReader = xmlReaderForIO(abwxmlZlibInputReadFunc, abwxmlInputCloseFunc, (void *)zlibStream, nullptr, nullptr, options);
+  else if (input && isInMemory(input) && getRemainingData(input, data, size))
+  {
+    // the data must stay valid until the reader is freed, so the stream
+    // must not be used meanwhile
+    xmlReader = xmlReaderForMemory(reinterpret_cast<const char *>(data), int(size), nullptr, nullptr, options);
+    if (xmlReader && inPlaceData && inPlaceSize)
+    {
+      *inPlaceData = data;
+      *inPlaceSize = size;
+    }
+  }
+  else
+    xmlReader = xmlReaderForIO(abwxmlInputReadFunc, abwxmlInputCloseFunc, (void *)input, nullptr, nullptr, options);
+
+  std::unique_ptr<xmlTextReader, void(*)(xmlTextReaderPtr)> reader(xmlReader, xmlFreeTextReader);
   if (watcher)
     watcher->setReader(reader.get());
   if (reader)
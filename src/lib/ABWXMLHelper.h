@@ -55,8 +55,12 @@ private:
   bool m_isStuck;
 };
 
-// create an xmlTextReader pointer from a librevenge::RVNGInputStream pointer
-std::unique_ptr<xmlTextReader, void(*)(xmlTextReaderPtr)> xmlReaderForStream(librevenge::RVNGInputStream *input, ABWXMLProgressWatcher *watcher = nullptr);
+// create an xmlTextReader pointer from a librevenge::RVNGInputStream pointer;
+// a stream holding its data in memory is parsed in place, so it must not
+// be used while the reader exists. In that case, the data and
+// their size are returned in inPlaceData and inPlaceSize, if given.
+std::unique_ptr<xmlTextReader, void(*)(xmlTextReaderPtr)> xmlReaderForStream(librevenge::RVNGInputStream *input, ABWXMLProgressWatcher *watcher = nullptr,
+                                                                             const unsigned char **inPlaceData = nullptr, unsigned long *inPlaceSize = nullptr);
 
 } // namespace libabw
 
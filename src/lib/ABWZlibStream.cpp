@@ -7,92 +7,55 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/.
  */
 
-#include <zlib.h>
-#include "ABWZlibStream.h"
+#include <algorithm>
 #include <string.h>  // for memcpy
+#include "ABWZlibStream.h"
+#include "libabw_internal.h"
 
 #define BLOCK_SIZE 16384
 
 namespace libabw
 {
 
-namespace
+ABWZlibStream::ABWZlibStream(librevenge::RVNGInputStream *input) :
+  librevenge::RVNGInputStream(),
+  m_input(nullptr),
+  m_compressedInput(nullptr),
+  m_strm(),
+  m_isStreamEnd(true),
+  m_offset(0),
+  m_bufferOffset(0),
+  m_buffer()
 {
+  if (!input)
+    return;
 
-static bool getInflatedBuffer(librevenge::RVNGInputStream *input, std::vector<unsigned char> &buffer)
-{
-  int ret;
-  z_stream strm;
-  unsigned char in[BLOCK_SIZE];
-  unsigned char out[BLOCK_SIZE];
-
-  strm.zalloc = Z_NULL;
-  strm.zfree = Z_NULL;
-  strm.opaque = Z_NULL;
-  strm.avail_in = 0;
-  strm.next_in = Z_NULL;
-  ret = inflateInit2(&strm, 16 + MAX_WBITS);
-  if (Z_OK != ret)
-    return false;
-
-  do
+  m_strm.zalloc = Z_NULL;
+  m_strm.zfree = Z_NULL;
+  m_strm.opaque = Z_NULL;
+  m_strm.avail_in = 0;
+  m_strm.next_in = Z_NULL;
+  if (Z_OK == inflateInit2(&m_strm, 16 + MAX_WBITS))
   {
-    unsigned long numBytesRead(0);
-    const unsigned char *p = input->read(BLOCK_SIZE, numBytesRead);
-    strm.avail_in = uInt(numBytesRead);
-    if (!strm.avail_in)
-      break;
-    memcpy(in, p, strm.avail_in);
-    strm.next_in = in;
-
-    do
-    {
-      strm.avail_out = BLOCK_SIZE;
-      strm.next_out = out;
-      ret = inflate(&strm, Z_NO_FLUSH);
-      switch (ret)
-      {
-      case Z_NEED_DICT:
-      case Z_DATA_ERROR:
-      case Z_MEM_ERROR:
-      case Z_STREAM_ERROR:
-        (void)inflateEnd(&strm);
-        return false;
-      default:
-        break;
-      }
-      for (unsigned i = 0; i < BLOCK_SIZE - strm.avail_out; ++i)
-        buffer.push_back(out[i]);
-    }
-    while (!strm.avail_out);
+    m_compressedInput = input;
+    m_isStreamEnd = false;
+    // Inflate the first block to find out if the input is compressed at all
+    if (_inflate(1) && !m_buffer.empty())
+      return;
+    (void)inflateEnd(&m_strm);
+    m_compressedInput = nullptr;
+    m_isStreamEnd = true;
+    m_buffer.clear();
   }
-  while (Z_STREAM_END != ret);
 
-  (void)inflateEnd(&strm);
   input->seek(0, librevenge::RVNG_SEEK_SET);
-  if (Z_STREAM_END == ret)
-    return true;
-  return false;
+  m_input = input;
 }
 
-}
-
-ABWZlibStream::ABWZlibStream(librevenge::RVNGInputStream *input) :
-  librevenge::RVNGInputStream(),
-  m_input(nullptr),
-  m_offset(0),
-  m_buffer()
+ABWZlibStream::~ABWZlibStream()
 {
-  if (!getInflatedBuffer(input, m_buffer))
-  {
-    if (input)
-    {
-      input->seek(0, librevenge::RVNG_SEEK_CUR);
-      m_input = input;
-    }
-    else
-      m_buffer.clear();
-  }
+  if (m_compressedInput)
+    (void)inflateEnd(&m_strm);
 }
 
 const unsigned char *ABWZlibStream::read(unsigned long numBytes, unsigned long &numBytesRead)
@@ -105,22 +68,17 @@ const unsigned char *ABWZlibStream::read(unsigned long numBytes, unsigned long &
   if (numBytes == 0)
     return nullptr;
 
-  unsigned long numBytesToRead;
-
-  if (((unsigned long)m_offset+numBytes) < m_buffer.size())
-    numBytesToRead = numBytes;
-  else
-    numBytesToRead = m_buffer.size() - (unsigned long)m_offset;
-
-  numBytesRead = numBytesToRead; // about as paranoid as we can be..
+  _fillBuffer((unsigned long)m_offset, numBytes);
 
-  if (numBytesToRead == 0)
+  const unsigned long bufferEnd = m_bufferOffset + m_buffer.size();
+  if ((unsigned long)m_offset >= bufferEnd)
     return nullptr;
 
-  long oldOffset = m_offset;
-  m_offset += numBytesToRead;
+  const unsigned long pos = (unsigned long)m_offset - m_bufferOffset;
+  numBytesRead = std::min(numBytes, bufferEnd - (unsigned long)m_offset);
+  m_offset += numBytesRead;
 
-  return &m_buffer[size_t(oldOffset)];
+  return &m_buffer[size_t(pos)];
 }
 
 int ABWZlibStream::seek(long offset, librevenge::RVNG_SEEK_TYPE seekType)
@@ -138,9 +96,13 @@ int ABWZlibStream::seek(long offset, librevenge::RVNG_SEEK_TYPE seekType)
     m_offset = 0;
     return 1;
   }
-  if ((long)m_offset > (long)m_buffer.size())
+
+  // the size is not known before the whole stream has been inflated
+  _fillBuffer((unsigned long)m_offset, 0);
+  const unsigned long bufferEnd = m_bufferOffset + m_buffer.size();
+  if ((unsigned long)m_offset > bufferEnd)
   {
-    m_offset = (long) m_buffer.size();
+    m_offset = (long) bufferEnd;
     return 1;
   }
 
@@ -160,11 +122,153 @@ bool ABWZlibStream::isEnd()
   if (m_input)
     return m_input->isEnd();
 
-  if ((long)m_offset >= (long)m_buffer.size())
+  _fillBuffer((unsigned long)m_offset, 1);
+  if ((unsigned long)m_offset >= m_bufferOffset + m_buffer.size())
     return true;
 
   return false;
 }
 
+/* Reads up to numBytes bytes into buffer, like read() followed by a
+   copy, but inflating directly into buffer when the data are not in the
+   window already.
+ */
+unsigned long ABWZlibStream::readTo(unsigned char *buffer, unsigned long numBytes)
+{
+  if (!m_compressedInput)
+  {
+    unsigned long numBytesRead = 0;
+    const unsigned char *data = read(numBytes, numBytesRead);
+    if (data && numBytesRead)
+      memcpy(buffer, data, numBytesRead);
+    return numBytesRead;
+  }
+
+  if (!numBytes)
+    return 0;
+
+  _fillBuffer((unsigned long)m_offset, 0);
+  const unsigned long bufferEnd = m_bufferOffset + m_buffer.size();
+  unsigned long numBytesRead = 0;
+  if ((unsigned long)m_offset < bufferEnd)
+  {
+    numBytesRead = std::min(numBytes, bufferEnd - (unsigned long)m_offset);
+    memcpy(buffer, &m_buffer[size_t((unsigned long)m_offset - m_bufferOffset)], numBytesRead);
+  }
+  else if ((unsigned long)m_offset == bufferEnd)
+  {
+    m_bufferOffset = bufferEnd;
+    m_buffer.clear();
+    _inflateTo(buffer, numBytes, numBytesRead);
+    m_bufferOffset += numBytesRead;
+  }
+  m_offset += numBytesRead;
+
+  return numBytesRead;
+}
+
+/* Inflates more data at the end of m_buffer, until it holds at least size
+   bytes or the compressed stream ends. Returns false on a zlib error; the
+   data inflated up to that point remain readable.
+ */
+bool ABWZlibStream::_inflate(unsigned long size)
+{
+  while (m_buffer.size() < size && !m_isStreamEnd)
+  {
+    const size_t oldSize = m_buffer.size();
+    unsigned long numBytesInflated = 0;
+    m_buffer.resize(oldSize + BLOCK_SIZE);
+    const bool ok = _inflateTo(&m_buffer[oldSize], BLOCK_SIZE, numBytesInflated);
+    m_buffer.resize(oldSize + numBytesInflated);
+    if (!ok)
+      return false;
+  }
+  return true;
+}
+
+/* Inflates at most size bytes into buffer. It only returns without any
+   data at the end of the compressed stream. Returns false on a zlib error.
+ */
+bool ABWZlibStream::_inflateTo(unsigned char *buffer, unsigned long size, unsigned long &numBytesInflated)
+{
+  numBytesInflated = 0;
+  while (!numBytesInflated && !m_isStreamEnd)
+  {
+    if (!m_strm.avail_in)
+    {
+      unsigned long numBytesRead(0);
+      const unsigned char *p = m_compressedInput->read(BLOCK_SIZE, numBytesRead);
+      if (!numBytesRead)
+      {
+        // truncated stream
+        m_isStreamEnd = true;
+        break;
+      }
+      // zlib is done with the previous block once avail_in drops to 0,
+      // so inflate straight from the stream's buffer
+      m_strm.next_in = const_cast<unsigned char *>(p);
+      m_strm.avail_in = uInt(numBytesRead);
+    }
+
+    m_strm.next_out = buffer;
+    m_strm.avail_out = uInt(size);
+    const int ret = inflate(&m_strm, Z_NO_FLUSH);
+    numBytesInflated = size - m_strm.avail_out;
+    switch (ret)
+    {
+    case Z_NEED_DICT:
+    case Z_DATA_ERROR:
+    case Z_MEM_ERROR:
+    case Z_STREAM_ERROR:
+      ABW_DEBUG_MSG(("ABWZlibStream::_inflateTo: inflate failed with %i\n", ret));
+      m_isStreamEnd = true;
+      return false;
+    case Z_STREAM_END:
+      m_isStreamEnd = true;
+      break;
+    default:
+      break;
+    }
+  }
+  return true;
+}
+
+/* Makes m_buffer contain the inflated data starting at offset, with at
+   least numBytes bytes after it if the stream is long enough. The data
+   before offset are dropped, unless they are already in the buffer and
+   no more data are needed.
+ */
+void ABWZlibStream::_fillBuffer(unsigned long offset, unsigned long numBytes)
+{
+  if (offset < m_bufferOffset)
+    _restart();
+  if (offset + numBytes <= m_bufferOffset + m_buffer.size())
+    return;
+
+  while (offset > m_bufferOffset + m_buffer.size())
+  {
+    m_bufferOffset += m_buffer.size();
+    m_buffer.clear();
+    if (m_isStreamEnd)
+      return;
+    _inflate(std::min(offset - m_bufferOffset, (unsigned long) BLOCK_SIZE));
+  }
+
+  m_buffer.erase(m_buffer.begin(), m_buffer.begin() + long(offset - m_bufferOffset));
+  m_bufferOffset = offset;
+  _inflate(numBytes);
+}
+
+void ABWZlibStream::_restart()
+{
+  (void)inflateReset(&m_strm);
+  m_strm.next_in = Z_NULL;
+  m_strm.avail_in = 0;
+  m_compressedInput->seek(0, librevenge::RVNG_SEEK_SET);
+  m_isStreamEnd = false;
+  m_bufferOffset = 0;
+  m_buffer.clear();
+}
+
 } // namespace libabw
 /* vim:set shiftwidth=2 softtabstop=2 expandtab: */
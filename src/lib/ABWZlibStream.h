@@ -11,16 +11,24 @@
 #define __ABWZLIBSTREAM_H__
 
 #include <vector>
+#include <zlib.h>
 #include <librevenge-stream/librevenge-stream.h>
 
 namespace libabw
 {
 
+/** Input stream inflating a gzip compressed stream, or passing the
+    input through if it is not compressed.
+
+    The data are inflated when they are read. Only a small window of the
+    inflated data is kept, so seeking back before it starts inflating
+    again from the beginning.
+  */
 class ABWZlibStream : public librevenge::RVNGInputStream
 {
 public:
   ABWZlibStream(librevenge::RVNGInputStream *input);
-  ~ABWZlibStream() override {}
+  ~ABWZlibStream() override;
 
   bool isStructured() override
   {
@@ -50,13 +58,31 @@ public:
   int seek(long offset, librevenge::RVNG_SEEK_TYPE seekType) override;
   long tell() override;
   bool isEnd() override;
-  unsigned long getSize() const
+
+  bool isCompressed() const
+  {
+    return m_compressedInput != nullptr;
+  }
+  unsigned long readTo(unsigned char *buffer, unsigned long numBytes);
+  //! the input passed through, if it is not compressed
+  librevenge::RVNGInputStream *getUncompressedInput() const
   {
-    return m_buffer.size();
+    return m_input;
   }
+
 private:
+  bool _inflate(unsigned long size);
+  bool _inflateTo(unsigned char *buffer, unsigned long size, unsigned long &numBytesInflated);
+  void _fillBuffer(unsigned long offset, unsigned long numBytes);
+  void _restart();
+
   librevenge::RVNGInputStream *m_input;
+  librevenge::RVNGInputStream *m_compressedInput;
+  z_stream m_strm;
+  bool m_isStreamEnd;
   volatile long m_offset;
+  //! the offset of the first byte of m_buffer in the inflated stream
+  unsigned long m_bufferOffset;
   std::vector<unsigned char> m_buffer;
   ABWZlibStream(const ABWZlibStream &);
   ABWZlibStream &operator=(const ABWZlibStream &);
@@ -7,7 +7,10 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/.
  */
 
+#include <vector>
 #include <libabw/libabw.h>
+#include <librevenge-stream/librevenge-stream.h>
+#include "ABWMappedFileStream.h"
 #include "ABWXMLHelper.h"
 #include "ABWParser.h"
 #include "ABWZlibStream.h"
@@ -20,38 +23,32 @@ static xmlChar *call_BAD_CAST_OnConst(char const *str)
 {
   return BAD_CAST(const_cast<char *>(str));
 }
-}
 
-/**
-\mainpage libabw documentation
-This document contains both the libabw API specification and the normal libabw
-documentation.
-\section api_docs libabw API documentation
-The external libabw API is provided by the AbiDocument class. This class, combined
-with the librevenge::RVNGTextInterface class, are the only two classes that will be of interest
-for the application programmer using libabw.
-\section lib_docs libabw documentation
-If you are interested in the structure of libabw itself, this whole document
-would be a good starting point for exploring the internals of libabw. Mind that
-this document is a work-in-progress, and will most likely not cover libabw for
-the full 100%.
-*/
+// The root element must start within this many bytes of the (inflated) document
+static const unsigned long ABW_HEADER_SIZE = 8192;
 
-/**
-Analyzes the content of an input stream to see if it can be parsed
-\param input The input stream
-\return A confidence value which represents the likelihood that the content from
-the input stream can be parsed
-*/
-ABWAPI bool libabw::AbiDocument::isFileFormatSupported(librevenge::RVNGInputStream *input) try
+// Reads at most ABW_HEADER_SIZE bytes from the start of the stream
+static void readHeader(librevenge::RVNGInputStream *input, std::vector<unsigned char> &header)
 {
-  ABW_DEBUG_MSG(("AbiDocument::isFileFormatSupported\n"));
-  if (!input)
+  while (header.size() < ABW_HEADER_SIZE && !input->isEnd())
+  {
+    unsigned long numBytesRead = 0;
+    const unsigned char *data = input->read(ABW_HEADER_SIZE - header.size(), numBytesRead);
+    if (!data || !numBytesRead)
+      break;
+    header.insert(header.end(), data, data + numBytesRead);
+  }
+}
+
+static bool isSupported(ABWZlibStream *stream)
+{
+  std::vector<unsigned char> header;
+  stream->seek(0, librevenge::RVNG_SEEK_SET);
+  readHeader(stream, header);
+  if (header.empty())
     return false;
-  input->seek(0, librevenge::RVNG_SEEK_SET);
-  libabw::ABWZlibStream stream(input);
-  stream.seek(0, librevenge::RVNG_SEEK_SET);
-  auto reader = libabw::xmlReaderForStream(&stream);
+  librevenge::RVNGStringStream headerStream(&header[0], (unsigned) header.size());
+  auto reader = xmlReaderForStream(&headerStream);
   if (!reader)
     return false;
   int ret = xmlTextReaderRead(reader.get());
@@ -81,6 +78,79 @@ ABWAPI bool libabw::AbiDocument::isFileFormatSupported(librevenge::RVNGInputStre
 
   return true;
 }
+
+struct AbiDocumentHandleImpl
+{
+  explicit AbiDocumentHandleImpl(librevenge::RVNGInputStream *input);
+  explicit AbiDocumentHandleImpl(std::unique_ptr<ABWMappedFileStream> file);
+
+  //! the mapped file, if the handle was opened from a path
+  std::unique_ptr<ABWMappedFileStream> m_file;
+  ABWZlibStream m_stream;
+  bool m_isChecked;
+  bool m_isSupported;
+  bool m_isStreaming;
+  unsigned long m_spillThreshold;
+  bool m_mergeEvents;
+  AbiDocumentStatistics m_statistics;
+};
+
+AbiDocumentHandleImpl::AbiDocumentHandleImpl(librevenge::RVNGInputStream *input) :
+  m_file(),
+  m_stream(input),
+  m_isChecked(false),
+  m_isSupported(false),
+  m_isStreaming(false),
+  m_spillThreshold(0),
+  m_mergeEvents(false),
+  m_statistics()
+{
+}
+
+AbiDocumentHandleImpl::AbiDocumentHandleImpl(std::unique_ptr<ABWMappedFileStream> file) :
+  m_file(std::move(file)),
+  m_stream(m_file.get()),
+  m_isChecked(false),
+  m_isSupported(false),
+  m_isStreaming(false),
+  m_spillThreshold(0),
+  m_mergeEvents(false),
+  m_statistics()
+{
+}
+
+}
+
+/**
+\mainpage libabw documentation
+This document contains both the libabw API specification and the normal libabw
+documentation.
+\section api_docs libabw API documentation
+The external libabw API is provided by the AbiDocument class. This class, combined
+with the librevenge::RVNGTextInterface class, are the only two classes that will be of interest
+for the application programmer using libabw.
+\section lib_docs libabw documentation
+If you are interested in the structure of libabw itself, this whole document
+would be a good starting point for exploring the internals of libabw. Mind that
+this document is a work-in-progress, and will most likely not cover libabw for
+the full 100%.
+*/
+
+/**
+Analyzes the content of an input stream to see if it can be parsed
+\param input The input stream
+\return A confidence value which represents the likelihood that the content from
+the input stream can be parsed
+*/
+ABWAPI bool libabw::AbiDocument::isFileFormatSupported(librevenge::RVNGInputStream *input) try
+{
+  ABW_DEBUG_MSG(("AbiDocument::isFileFormatSupported\n"));
+  if (!input)
+    return false;
+  input->seek(0, librevenge::RVNG_SEEK_SET);
+  libabw::ABWZlibStream stream(input);
+  return libabw::isSupported(&stream);
+}
 catch (...)
 {
   return false;
@@ -104,7 +174,7 @@ ABWAPI bool libabw::AbiDocument::parse(librevenge::RVNGInputStream *input, libre
     return false;
   input->seek(0, librevenge::RVNG_SEEK_SET);
   libabw::ABWZlibStream stream(input);
-  libabw::ABWParser parser(&stream, textInterface);
+  libabw::ABWParser parser(&stream, textInterface, false, 0, false);
   if (parser.parse())
     return true;
   return false;
@@ -114,4 +184,167 @@ catch (...)
   return false;
 }
 
+/**
+Opens the input stream, so that it can be checked and parsed without
+inflating it twice.
+\param input The input stream; it must outlive the returned handle
+\return A handle to the document, or null if it could not be created
+*/
+ABWAPI std::unique_ptr<libabw::AbiDocumentHandle> libabw::AbiDocument::open(librevenge::RVNGInputStream *input) try
+{
+  ABW_DEBUG_MSG(("AbiDocument::open\n"));
+  if (input)
+    input->seek(0, librevenge::RVNG_SEEK_SET);
+  return std::unique_ptr<AbiDocumentHandle>(new AbiDocumentHandle(input ? new AbiDocumentHandleImpl(input) : nullptr));
+}
+catch (...)
+{
+  return std::unique_ptr<AbiDocumentHandle>();
+}
+
+/**
+Opens a file, mapping it into memory instead of reading it through a
+stream. Uncompressed documents are then parsed straight from the mapping
+and compressed ones are inflated from it.
+\param path The path of the file
+\return A handle to the document, or null if it could not be created
+*/
+ABWAPI std::unique_ptr<libabw::AbiDocumentHandle> libabw::AbiDocument::openFile(const char *path) try
+{
+  ABW_DEBUG_MSG(("AbiDocument::openFile\n"));
+  std::unique_ptr<ABWMappedFileStream> file(new ABWMappedFileStream(path));
+  if (!file->isOpen())
+    return std::unique_ptr<AbiDocumentHandle>(new AbiDocumentHandle(nullptr));
+  return std::unique_ptr<AbiDocumentHandle>(new AbiDocumentHandle(new AbiDocumentHandleImpl(std::move(file))));
+}
+catch (...)
+{
+  return std::unique_ptr<AbiDocumentHandle>();
+}
+
+/**
+Parses a file, if it is an AbiWord document. See AbiDocument::openFile.
+\param path The path of the file
+\param textInterface A librevenge::RVNGTextInterface implementation
+\return A value that indicates whether the conversion was successful
+*/
+ABWAPI bool libabw::AbiDocument::parseFile(const char *path, librevenge::RVNGTextInterface *textInterface) try
+{
+  ABW_DEBUG_MSG(("AbiDocument::parseFile\n"));
+  auto document = openFile(path);
+  return document && document->isSupported() && document->parse(textInterface);
+}
+catch (...)
+{
+  return false;
+}
+
+libabw::AbiDocumentHandle::AbiDocumentHandle(AbiDocumentHandleImpl *impl) :
+  m_impl(impl)
+{
+}
+
+ABWAPI libabw::AbiDocumentHandle::~AbiDocumentHandle()
+{
+}
+
+/**
+Analyzes the content of the opened document to see if it can be parsed.
+The result is computed only once.
+\return Whether the document is an AbiWord document
+*/
+ABWAPI bool libabw::AbiDocumentHandle::isSupported() try
+{
+  ABW_DEBUG_MSG(("AbiDocumentHandle::isSupported\n"));
+  if (!m_impl)
+    return false;
+  if (!m_impl->m_isChecked)
+  {
+    m_impl->m_isSupported = libabw::isSupported(&m_impl->m_stream);
+    m_impl->m_isChecked = true;
+  }
+  return m_impl->m_isSupported;
+}
+catch (...)
+{
+  return false;
+}
+
+/**
+Parses the opened document. It will make callbacks to the functions provided by a
+librevenge::RVNGTextInterface class implementation when needed.
+\param textInterface A librevenge::RVNGTextInterface implementation
+\return A value that indicates whether the conversion was successful
+*/
+ABWAPI bool libabw::AbiDocumentHandle::parse(librevenge::RVNGTextInterface *textInterface) try
+{
+  ABW_DEBUG_MSG(("AbiDocumentHandle::parse\n"));
+  if (!m_impl)
+    return false;
+  m_impl->m_stream.seek(0, librevenge::RVNG_SEEK_SET);
+  libabw::ABWParser parser(&m_impl->m_stream, textInterface, m_impl->m_isStreaming, m_impl->m_spillThreshold,
+                           m_impl->m_mergeEvents);
+  const bool parsed = parser.parse();
+  parser.getStatistics(m_impl->m_statistics);
+  return parsed;
+}
+catch (...)
+{
+  return false;
+}
+
+/**
+Makes parse write the document while it is read, instead of once it was
+read completely. The styles are then collected in a first pass over the
+document. The body is written as soon as it can not change any more; a
+page span using headers or footers is only written once they are
+complete. Frames anchored to the page are written where they are found,
+not before the body.
+\param streaming Whether the document is written while it is read
+*/
+ABWAPI void libabw::AbiDocumentHandle::setStreaming(const bool streaming)
+{
+  if (m_impl)
+    m_impl->m_isStreaming = streaming;
+}
+
+/**
+Makes parse move the events and the texts of the output it buffers to a
+temporary file once they take more than the given size, so that big
+documents can be converted with little memory. Only the events and the
+texts are counted and moved: the property lists, tables, page spans,
+images and list levels of the output stay in memory, as librevenge can not
+write property lists to a file exactly.
+\param threshold The size in bytes, or 0 to keep the output in memory
+*/
+ABWAPI void libabw::AbiDocumentHandle::setSpillThreshold(const unsigned long threshold)
+{
+  if (m_impl)
+    m_impl->m_spillThreshold = threshold;
+}
+
+/**
+Makes parse merge a span with the next one if it has the same properties
+and nothing is between them, and send consecutive texts in one call. The
+document written is the same, with fewer callbacks.
+\param merge Whether to merge the events
+*/
+ABWAPI void libabw::AbiDocumentHandle::setMergeEvents(const bool merge)
+{
+  if (m_impl)
+    m_impl->m_mergeEvents = merge;
+}
+
+/**
+Tells how the last call of parse shared the span and paragraph property
+lists of its output, to check how much memory the sharing saves.
+\return The statistics, all 0 if the document was not parsed
+*/
+ABWAPI libabw::AbiDocumentStatistics libabw::AbiDocumentHandle::getStatistics() const
+{
+  if (m_impl)
+    return m_impl->m_statistics;
+  return AbiDocumentStatistics();
+}
+
 /* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,83 @@
+#!/usr/bin/env perl
+#
+# This file is part of the libabw project.
+#
+# This Source Code Form is subject to the terms of the Mozilla Public
+# License, v. 2.0. If a copy of the MPL was not distributed with this
+# file, You can obtain one at http://mozilla.org/MPL/2.0/.
+#
+# Generates the ids of the properties listed in props.txt, and the gperf
+# input of their lookup table.
+#
+# usage: genprops.pl props.txt props.h props.gperf
+
+$ARGV0 = shift @ARGV;
+$ARGV1 = shift @ARGV;
+$ARGV2 = shift @ARGV;
+
+open ( PROPS, $ARGV0 ) || die "can't open property file: $!";
+my %props;
+my %types;
+my @typeNames = ( "none", "int", "length" );
+
+while ( defined ($line = <PROPS>) )
+{
+    if( !($line =~ /^#/) )
+    {
+        chomp($line);
+        @token = split(/\s+/,$line);
+        if ( not defined ($token[1]) )
+        {
+            $token[1] = "none";
+        }
+        grep( $_ eq $token[1], @typeNames ) || die "unknown type $token[1] of property $token[0]";
+
+        $props{$token[0]} = "PROP_".$token[0];
+        $props{$token[0]} =~ tr/\-\.\:/___/;
+        $props{$token[0]} = uc($props{$token[0]});
+        $types{$token[0]} = uc("PROP_TYPE_".$token[1]);
+    }
+}
+close ( PROPS );
+
+open ( HXX, ">$ARGV1" ) || die "can't open $ARGV1: $!";
+open ( GPERF, ">$ARGV2" ) || die "can't open $ARGV2: $!";
+
+print ( GPERF "%language=C++\n" );
+print ( GPERF "%global-table\n" );
+print ( GPERF "%null-strings\n" );
+print ( GPERF "%struct-type\n" );
+print ( GPERF "struct proptoken\n" );
+print ( GPERF "{\n" );
+print ( GPERF "  const char *name;\n  int propId;\n  int propType;\n" );
+print ( GPERF "};\n" );
+print ( GPERF "%%\n" );
+
+print ( HXX "#ifndef __ABWPROPS_HXX__\n" );
+print ( HXX "#define __ABWPROPS_HXX__\n" );
+print ( HXX "\n" );
+
+$i = 0;
+foreach( @typeNames )
+{
+    print( HXX "const int ".uc("PROP_TYPE_$_")." = $i;\n" );
+    $i = $i + 1;
+}
+print ( HXX "\n" );
+
+$i = 0;
+foreach( sort(keys(%props)) )
+{
+    $i = $i + 1;
+    print( HXX "const int $props{$_} = $i;\n" );
+    print( GPERF "$_,$props{$_},$types{$_}\n" );
+}
+print ( GPERF "%%\n" );
+print ( HXX "\n" );
+print ( HXX "const int PROP_COUNT = $i;\n" );
+print ( HXX "\n" );
+print ( HXX "const int PROP_INVALID = -1;\n" );
+print ( HXX "\n" );
+print ( HXX "#endif\n" );
+close ( HXX );
+close ( GPERF );